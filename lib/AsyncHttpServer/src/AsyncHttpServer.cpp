@@ -0,0 +1,998 @@
+// =====================================================================
+// AsyncHttpServer
+// =====================================================================
+// Request parsing, routing and response assembly. See AsyncHttpServer.h for the overall design and
+// HttpTransport.h for the TCP layer underneath.
+
+#include "AsyncHttpServer.h"
+#include "HttpTransport.h"
+
+static_assert(HTTP_BUFFER_BUDGET > HTTP_MAX_BODY_SIZE, "HTTP_BUFFER_BUDGET must hold the largest request body");
+
+// statusText(int code)
+// Returns the reason phrase for the status codes the server and the sketch use.
+
+static const char* statusText(int code)
+{
+  switch (code) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 303: return "See Other";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 411: return "Length Required";
+    case 412: return "Precondition Failed";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 428: return "Precondition Required";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+// findHeader(char* headers, const char* name, size_t* length)
+// Finds a header in the raw header lines (after the request line, ending with an empty line).
+// - Name match is case-insensitive; the value is returned without surrounding whitespace.
+// - Returns nullptr if the header is absent.
+
+static char* findHeader(char* headers, const char* name, size_t* length)
+{
+  size_t nameLength = strlen(name);
+  char* line = headers;
+  while (line[0] != '\r') {
+    char* lineEnd = strstr(line, "\r\n");
+    if (!lineEnd) break;
+    if (strncasecmp(line, name, nameLength) == 0 && line[nameLength] == ':') {
+      char* value = line + nameLength + 1;
+      while (value < lineEnd && (*value == ' ' || *value == '\t')) value++;
+      char* valueEnd = lineEnd;
+      while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) valueEnd--;
+      *length = valueEnd - value;
+      return value;
+    }
+    line = lineEnd + 2;
+  }
+  return nullptr;
+}
+
+// assign(String& target, const char* data, size_t length)
+// Sets target to data[0..length), which need not be terminated.
+
+static void assign(String& target, const char* data, size_t length)
+{
+  target = String();
+  target.reserve(length);
+  for (size_t i = 0; i < length; i++) {
+    target += data[i];
+  }
+}
+
+// urlDecode(String& target, const char* data, size_t length)
+// Sets target to the application/x-www-form-urlencoded decoding of data[0..length) ('+' and %XX).
+
+static void urlDecode(String& target, const char* data, size_t length)
+{
+  target = String();
+  target.reserve(length);
+  for (size_t i = 0; i < length; i++) {
+    char c = data[i];
+    if (c == '+') {
+      c = ' ';
+    } else if (c == '%' && i + 2 < length && isxdigit(data[i + 1]) && isxdigit(data[i + 2])) {
+      char hex[3] = { data[i + 1], data[i + 2], '\0' };
+      c = (char)strtoul(hex, nullptr, 16);
+      i += 2;
+    }
+    target += c;
+  }
+}
+
+// urlDecodeInPlace(char* data, size_t length)
+// urlDecode() into data itself (the decoding is never longer); returns the decoded length.
+
+static size_t urlDecodeInPlace(char* data, size_t length)
+{
+  size_t out = 0;
+  for (size_t i = 0; i < length; i++) {
+    char c = data[i];
+    if (c == '+') {
+      c = ' ';
+    } else if (c == '%' && i + 2 < length && isxdigit(data[i + 1]) && isxdigit(data[i + 2])) {
+      char hex[3] = { data[i + 1], data[i + 2], '\0' };
+      c = (char)strtoul(hex, nullptr, 16);
+      i += 2;
+    }
+    data[out++] = c;
+  }
+  return out;
+}
+
+AsyncHttpServer::AsyncHttpServer(uint16_t port)
+  : _port(port), _listener(nullptr), _connections(), _firstRoute(nullptr), _lastRoute(nullptr),
+    _keepAliveTimeout(HTTP_KEEP_ALIVE_TIMEOUT), _keepAliveMax(HTTP_KEEP_ALIVE_MAX), _stats(), _current(nullptr),
+    _method(HTTP_GET), _argCount(0), _headerCount(0),
+    _contentLength(CONTENT_LENGTH_NOT_SET), _responseStarted(false), _responseFinished(false),
+    _chunked(false), _headersOnly(false)
+{
+}
+
+// begin()
+// Starts listening. Call once after the routes are registered.
+
+void AsyncHttpServer::begin()
+{
+  _listener = httpTransportListen(*this, _port);
+}
+
+// handleClient()
+// Services all connections; call from loop().
+// - Reads what has arrived, dispatches each complete request to its handler and pushes pending output,
+//   including output a handler queued because the client was not taking it yet.
+// - Once a response is sent the connection is closed, or kept for the next request (keep-alive).
+// - Closes connections whose client hung up, that made no progress in time (HTTP_REQUEST_TIMEOUT since the
+//   last byte, or HTTP_REQUEST_MAX_TIME since the request began), or that stayed idle between requests for
+//   longer than the keep-alive timeout.
+
+void AsyncHttpServer::handleClient()
+{
+  for (HttpConnection& conn : _connections) {
+    if (conn.state == HTTP_CONN_READING) {
+      if (readRequest(conn)) {
+        dispatch(conn);
+      } else if (conn.state == HTTP_CONN_READING) {
+        bool idle = conn.requestCount > 0 && conn.rxLength == 0;
+        if (conn.peerClosed && !conn.rxPending) {
+          closeConnection(conn);
+        } else if (idle && millis() - conn.lastActivity > _keepAliveTimeout) {
+          closeConnection(conn);
+        } else if (!idle && (millis() - conn.lastActivity > HTTP_REQUEST_TIMEOUT ||
+                             millis() - conn.requestStart > HTTP_REQUEST_MAX_TIME)) {
+          _stats.timeouts++;
+          closeConnection(conn);
+        }
+      }
+    }
+    if (conn.state == HTTP_CONN_SENDING) {
+      drain(conn);
+      if (!conn.pcb) {
+        releaseConnection(conn);
+      } else if (conn.txLength == 0 && !conn.txQueue && conn.txFlashLength == 0) {
+        if (conn.keepAlive) {
+          startNextRequest(conn);
+        } else {
+          closeConnection(conn);
+        }
+      } else if (millis() - conn.lastActivity > HTTP_SEND_TIMEOUT) {
+        _stats.timeouts++;
+        httpTransportAbort(conn);
+        releaseConnection(conn);
+      }
+    }
+  }
+}
+
+// on(uri, [method,] handler) / onNotFound(handler)
+// Registers a handler for an exact path (query string excluded). Routes are matched in registration order;
+// HTTP_ANY matches every method, and a GET route also answers HEAD.
+
+void AsyncHttpServer::on(const String& uri, THandlerFunction handler)
+{
+  on(uri, HTTP_ANY, handler);
+}
+
+void AsyncHttpServer::on(const String& uri, HTTPMethod method, THandlerFunction handler)
+{
+  addRoute(uri, method, handler, false);
+}
+
+// onStream(const String& uri, HTTPMethod method, THandlerFunction handler)
+// Registers a handler that reads the request body itself, through body(), instead of getting it as args.
+// The body is received like any other (up to HTTP_MAX_BODY_SIZE, without blocking) and the handler runs once
+// all of it is in; body() then reads it in one pass, e.g. deserializeJson(doc, server.body()), or formField()
+// decodes one form field in place, without the String copy of each field that args would make.
+
+void AsyncHttpServer::onStream(const String& uri, HTTPMethod method, THandlerFunction handler)
+{
+  addRoute(uri, method, handler, true);
+}
+
+void AsyncHttpServer::addRoute(const String& uri, HTTPMethod method, THandlerFunction handler, bool streamBody)
+{
+  Route* route = new Route{ uri, method, handler, streamBody, nullptr };
+  if (_lastRoute) {
+    _lastRoute->next = route;
+  } else {
+    _firstRoute = route;
+  }
+  _lastRoute = route;
+}
+
+void AsyncHttpServer::onNotFound(THandlerFunction handler)
+{
+  _notFoundHandler = handler;
+}
+
+// setKeepAlive(unsigned long idleTimeout, uint16_t maxRequests)
+// Sets how long (ms) an idle persistent connection is kept and how many requests it may carry before the
+// server closes it. An idleTimeout or maxRequests of 0 closes every connection after one response.
+// Defaults: HTTP_KEEP_ALIVE_TIMEOUT, HTTP_KEEP_ALIVE_MAX.
+
+void AsyncHttpServer::setKeepAlive(unsigned long idleTimeout, uint16_t maxRequests)
+{
+  _keepAliveTimeout = idleTimeout;
+  _keepAliveMax = maxRequests;
+}
+
+// collectHeaders(const char* headerKeys[], const size_t headerKeysCount)
+// Selects the request headers kept for header()/hasHeader(); at most HTTP_MAX_HEADERS.
+
+void AsyncHttpServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount)
+{
+  _headerCount = std::min(headerKeysCount, (size_t)HTTP_MAX_HEADERS);
+  for (size_t i = 0; i < _headerCount; i++) {
+    _headerNames[i] = headerKeys[i];
+  }
+}
+
+String AsyncHttpServer::arg(const String& name) const
+{
+  for (int i = 0; i < _argCount; i++) {
+    if (_argNames[i] == name) return _argValues[i];
+  }
+  return String();
+}
+
+bool AsyncHttpServer::hasArg(const String& name) const
+{
+  for (int i = 0; i < _argCount; i++) {
+    if (_argNames[i] == name) return true;
+  }
+  return false;
+}
+
+// formField(const char* name)
+// For an onStream() route with an application/x-www-form-urlencoded body: URL-decodes the value of field name
+// (matched as sent) in place, in the body buffer, and returns it NUL-terminated; nullptr if there is no such
+// field. A form value as large as the body thus needs no second buffer. The body is overwritten, so call it
+// once per request and do not read body() after it.
+
+char* AsyncHttpServer::formField(const char* name)
+{
+  if (!_current || !_current->streamBody || !_current->body) return nullptr;
+  char* data = _current->body;
+  char* end = data + _current->bodyLength;
+  size_t nameLength = strlen(name);
+  while (data < end) {
+    char* pairEnd = (char*)memchr(data, '&', end - data);
+    if (!pairEnd) pairEnd = end;
+    if ((size_t)(pairEnd - data) > nameLength && data[nameLength] == '=' && memcmp(data, name, nameLength) == 0) {
+      char* value = data + nameLength + 1;
+      value[urlDecodeInPlace(value, pairEnd - value)] = '\0';
+      _body.begin(nullptr, 0);
+      return value;
+    }
+    data = pairEnd + 1;
+  }
+  return nullptr;
+}
+
+String AsyncHttpServer::header(const String& name) const
+{
+  for (size_t i = 0; i < _headerCount; i++) {
+    if (_headerNames[i].equalsIgnoreCase(name)) return _headerValues[i];
+  }
+  return String();
+}
+
+bool AsyncHttpServer::hasHeader(const String& name) const
+{
+  return header(name).length() > 0;
+}
+
+// sendHeader(const String& name, const String& value, bool first)
+// Adds a header to the next response; must be called before send().
+
+void AsyncHttpServer::sendHeader(const String& name, const String& value, bool first)
+{
+  String line = name + ": " + value + "\r\n";
+  if (first) {
+    _responseHeaders = line + _responseHeaders;
+  } else {
+    _responseHeaders += line;
+  }
+}
+
+// send(int code, const char* contentType, content)
+// Sends a complete response. After setContentLength(CONTENT_LENGTH_UNKNOWN) it only starts a chunked
+// response instead: continue with sendContent() and end it with sendContent("").
+
+void AsyncHttpServer::send(int code, const char* contentType, const char* content)
+{
+  send(code, contentType, content, strlen(content));
+}
+
+void AsyncHttpServer::send(int code, const char* contentType, const String& content)
+{
+  send(code, contentType, content.c_str(), content.length());
+}
+
+void AsyncHttpServer::send(int code, const char* contentType, const char* content, size_t length)
+{
+  if (!_current || _responseStarted) return;
+  bool streaming = _contentLength != CONTENT_LENGTH_NOT_SET;
+  beginResponse(code, contentType, streaming ? _contentLength : length);
+  if (length > 0) {
+    sendContent(content, length);
+  }
+  if (!streaming) {
+    finishResponse();
+  }
+}
+
+// send_P(int code, const char* contentType, PGM_P content, size_t length)
+// Sends a complete response whose body stays in flash; it is copied out one segment at a time as the
+// client acknowledges data, so the handler returns immediately.
+
+void AsyncHttpServer::send_P(int code, const char* contentType, PGM_P content, size_t length)
+{
+  if (!_current || _responseStarted) return;
+  beginResponse(code, contentType, length);
+  if (!_headersOnly) {
+    _current->txFlash = (const uint8_t*)content;
+    _current->txFlashLength = length;
+  }
+  finishResponse();
+}
+
+// sendContent(const char* content, size_t length)
+// Appends body data; in a chunked response each call is one chunk and a zero length ends the response.
+
+void AsyncHttpServer::sendContent(const char* content, size_t length)
+{
+  if (!_current || !_responseStarted || _responseFinished) return;
+  if (!_chunked) {
+    if (!_headersOnly) write(content, length);
+    return;
+  }
+  if (length == 0) {
+    if (!_headersOnly) write("0\r\n\r\n");
+    finishResponse();
+    return;
+  }
+  if (_headersOnly) return;
+  char chunkHeader[12];
+  snprintf(chunkHeader, sizeof(chunkHeader), "%x\r\n", (unsigned)length);
+  write(chunkHeader);
+  write(content, length);
+  write("\r\n");
+}
+
+uint8_t AsyncHttpServer::activeConnections() const
+{
+  uint8_t count = 0;
+  for (const HttpConnection& conn : _connections) {
+    if (conn.state != HTTP_CONN_FREE) count++;
+  }
+  return count;
+}
+
+// connectionAccepted(void* pcb)
+// Transport callback for a new client: takes a free slot and allocates its buffers.
+// - If all slots are busy, the longest-idle persistent connection is closed to make room; browsers keep
+//   spare connections open that would otherwise lock new clients out.
+// - Returns nullptr (the transport then refuses the connection) if no slot can be had or memory is short.
+
+HttpConnection* AsyncHttpServer::connectionAccepted(void* pcb)
+{
+  HttpConnection* slot = nullptr;
+  for (HttpConnection& conn : _connections) {
+    if (conn.state == HTTP_CONN_FREE) {
+      slot = &conn;
+      break;
+    }
+  }
+  if (!slot) {
+    slot = evictIdleConnection();
+  }
+  char* rxBuffer = slot ? (char*)malloc(HTTP_RX_BUFFER_SIZE) : nullptr;
+  uint8_t* txBuffer = rxBuffer ? (uint8_t*)malloc(HTTP_TX_BUFFER_SIZE) : nullptr;
+  if (!txBuffer) {
+    free(rxBuffer);
+    _stats.connectionsRejected++;
+    return nullptr;
+  }
+  HttpConnection& conn = *slot;
+  conn = HttpConnection();
+  conn.server = this;
+  conn.state = HTTP_CONN_READING;
+  conn.pcb = pcb;
+  conn.rxBuffer = rxBuffer;
+  conn.txBuffer = txBuffer;
+  conn.lastActivity = millis();
+  conn.requestStart = conn.lastActivity;
+  _stats.connectionsAccepted++;
+  _stats.peakConnections = std::max(_stats.peakConnections, activeConnections());
+  return &conn;
+}
+
+// connectionSent(HttpConnection& conn)
+// Transport callback when lwIP has room again: queues more of the pending response.
+
+void AsyncHttpServer::connectionSent(HttpConnection& conn)
+{
+  conn.lastActivity = millis();
+  drain(conn);
+}
+
+// connectionClosed(HttpConnection& conn)
+// Transport callback after a reset or error (conn.pcb is already cleared). The slot is freed right away,
+// unless a handler is running for it; dispatch() frees it when the handler returns.
+
+void AsyncHttpServer::connectionClosed(HttpConnection& conn)
+{
+  if (&conn != _current) {
+    releaseConnection(conn);
+  }
+}
+
+// RequestLine
+// Parts of the request line "METHOD target HTTP/1.x" of a received head; path and query point into it.
+
+struct RequestLine {
+  HTTPMethod method;
+  const char* path;
+  size_t pathLength;
+  const char* query;
+  size_t queryLength;
+  bool http10;
+};
+
+// parseRequestLine(const char* head, RequestLine& line)
+// Splits the request line without modifying the head. Returns false if it is malformed or the method unknown.
+
+static bool parseRequestLine(const char* head, RequestLine& line)
+{
+  static const struct { const char* name; HTTPMethod method; } methods[] = {
+    { "GET", HTTP_GET }, { "HEAD", HTTP_HEAD }, { "POST", HTTP_POST }, { "PUT", HTTP_PUT },
+    { "PATCH", HTTP_PATCH }, { "DELETE", HTTP_DELETE }, { "OPTIONS", HTTP_OPTIONS }
+  };
+
+  const char* lineEnd = strstr(head, "\r\n");
+  const char* target = (const char*)memchr(head, ' ', lineEnd - head);
+  if (!target) return false;
+  size_t nameLength = target++ - head;
+  const char* version = (const char*)memchr(target, ' ', lineEnd - target);
+  if (!version || lineEnd - version != 9 || strncmp(version + 1, "HTTP/1.", 7) != 0) return false;
+
+  size_t method = 0;
+  while (method < sizeof(methods) / sizeof(methods[0]) &&
+         !(strlen(methods[method].name) == nameLength && strncmp(head, methods[method].name, nameLength) == 0)) {
+    method++;
+  }
+  if (method == sizeof(methods) / sizeof(methods[0])) return false;
+  line.method = methods[method].method;
+
+  const char* query = (const char*)memchr(target, '?', version - target);
+  line.path = target;
+  line.pathLength = (query ? query : version) - target;
+  line.query = query ? query + 1 : version;
+  line.queryLength = version - line.query;
+  line.http10 = version[8] == '0';
+  return true;
+}
+
+// findRoute(HTTPMethod method, const char* path, size_t length)
+// Returns the first route for the path (not terminated) that accepts the method, or nullptr.
+
+AsyncHttpServer::Route* AsyncHttpServer::findRoute(HTTPMethod method, const char* path, size_t length) const
+{
+  for (Route* route = _firstRoute; route; route = route->next) {
+    bool methodMatches = route->method == HTTP_ANY || route->method == method ||
+                         (route->method == HTTP_GET && method == HTTP_HEAD);
+    if (methodMatches && route->uri.length() == length && strncmp(route->uri.c_str(), path, length) == 0) {
+      return route;
+    }
+  }
+  return nullptr;
+}
+
+// readRequest(HttpConnection& conn)
+// Reads available data into the connection; returns true once a complete request (head and body) is there.
+// - The head must fit in HTTP_RX_BUFFER_SIZE (else 431). Chunked request bodies are not supported (501).
+// - The body is read into its own buffer, sized from Content-Length and limited to HTTP_MAX_BODY_SIZE
+//   (else 413), as it arrives; the request is complete, and its handler runs, only once all of it is in.
+//   The buffer is taken from HTTP_BUFFER_BUDGET; while the budget is short the body waits in lwIP.
+//   onStream() routes read that buffer through body() instead of getting it split into args.
+// - "Expect: 100-continue" is answered as soon as the head is accepted, so clients such as curl send the
+//   body without waiting for their own timeout.
+// - Error responses are queued here and move the connection to HTTP_CONN_SENDING.
+
+bool AsyncHttpServer::readRequest(HttpConnection& conn)
+{
+  if (conn.headLength == 0) {
+    size_t count = httpTransportRead(conn, conn.rxBuffer + conn.rxLength, HTTP_RX_BUFFER_SIZE - 1 - conn.rxLength);
+    if (count == 0 && !conn.pipelined) return false;
+    if (conn.rxLength == 0) conn.requestStart = millis();
+    conn.pipelined = false;
+    conn.rxLength += count;
+    conn.rxBuffer[conn.rxLength] = '\0';
+    conn.lastActivity = millis();
+    char* headEnd = strstr(conn.rxBuffer, "\r\n\r\n");
+    if (!headEnd) {
+      if (conn.rxLength == HTTP_RX_BUFFER_SIZE - 1) sendError(conn, 431);
+      return false;
+    }
+    conn.headLength = headEnd + 4 - conn.rxBuffer;
+
+    size_t length;
+    char* headers = strstr(conn.rxBuffer, "\r\n") + 2;
+    if (findHeader(headers, "Transfer-Encoding", &length)) {
+      sendError(conn, 501);
+      return false;
+    }
+    char* value = findHeader(headers, "Content-Length", &length);
+    conn.contentLength = value ? strtoul(value, nullptr, 10) : 0;
+    RequestLine line;
+    Route* route = parseRequestLine(conn.rxBuffer, line) ? findRoute(line.method, line.path, line.pathLength) : nullptr;
+    conn.streamBody = route && route->streamBody;
+    if (conn.contentLength > HTTP_MAX_BODY_SIZE) {
+      sendError(conn, 413);
+      return false;
+    }
+    if (conn.contentLength > 0 && findHeader(headers, "Expect", &length)) {
+      static const char continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+      httpTransportWrite(conn, (const uint8_t*)continueResponse, sizeof(continueResponse) - 1);
+      httpTransportFlush(conn);
+    }
+  }
+  if (conn.contentLength > 0 && !conn.body) {
+    if (!reserveBuffer(conn.contentLength + 1)) return false; // Stays in lwIP until the budget has room
+    conn.body = (char*)malloc(conn.contentLength + 1);
+    if (!conn.body) {
+      releaseBuffer(conn.contentLength + 1);
+      sendError(conn, 503);
+      return false;
+    }
+    conn.bodyLength = std::min(conn.rxLength - conn.headLength, conn.contentLength);
+    memcpy(conn.body, conn.rxBuffer + conn.headLength, conn.bodyLength);
+  }
+  conn.requestLength = conn.headLength + conn.bodyLength;
+  if (conn.bodyLength < conn.contentLength) {
+    size_t count = httpTransportRead(conn, conn.body + conn.bodyLength, conn.contentLength - conn.bodyLength);
+    if (count == 0) return false;
+    conn.bodyLength += count;
+    conn.lastActivity = millis();
+    if (conn.bodyLength < conn.contentLength) return false;
+  }
+  if (conn.body) {
+    conn.body[conn.contentLength] = '\0';
+  }
+  return true;
+}
+
+// parseRequest(HttpConnection& conn)
+// Fills method, uri, args and the collected headers from the request in conn. Returns false if malformed.
+// - Args come from the query string and, for application/x-www-form-urlencoded bodies, from the body.
+//   Any other buffered body is available as arg("plain"), as with ESP8266WebServer.
+// - Decides keep-alive: HTTP/1.1 unless the client sent "Connection: close", HTTP/1.0 only with
+//   "Connection: keep-alive"; never beyond the max-requests limit.
+
+bool AsyncHttpServer::parseRequest(HttpConnection& conn)
+{
+  RequestLine line;
+  if (!parseRequestLine(conn.rxBuffer, line)) return false;
+  char* headers = strstr(conn.rxBuffer, "\r\n") + 2;
+  _method = line.method;
+  _headersOnly = _method == HTTP_HEAD;
+  assign(_uri, line.path, line.pathLength);
+  parseArgs(line.query, line.queryLength);
+
+  for (size_t i = 0; i < _headerCount; i++) {
+    size_t length;
+    char* value = findHeader(headers, _headerNames[i].c_str(), &length);
+    if (value) assign(_headerValues[i], value, length);
+  }
+
+  size_t length;
+  char* connection = findHeader(headers, "Connection", &length);
+  if (line.http10) {
+    conn.keepAlive = connection && strncasecmp(connection, "keep-alive", 10) == 0;
+  } else {
+    conn.keepAlive = !(connection && strncasecmp(connection, "close", 5) == 0);
+  }
+  conn.keepAlive = conn.keepAlive && _keepAliveTimeout > 0 && conn.requestCount + 1 < _keepAliveMax;
+
+  if (conn.body && !conn.streamBody) {
+    char* contentType = findHeader(headers, "Content-Type", &length);
+    if (contentType && strncasecmp(contentType, "application/x-www-form-urlencoded", 33) == 0) {
+      parseArgs(conn.body, conn.bodyLength);
+    } else if (_argCount < HTTP_MAX_ARGS) {
+      _argNames[_argCount] = "plain";
+      assign(_argValues[_argCount], conn.body, conn.bodyLength);
+      _argCount++;
+    }
+  }
+  return true;
+}
+
+// parseArgs(const char* data, size_t length)
+// Adds the name=value pairs of an urlencoded query or form body to the args, up to HTTP_MAX_ARGS.
+
+void AsyncHttpServer::parseArgs(const char* data, size_t length)
+{
+  const char* end = data + length;
+  while (data < end && _argCount < HTTP_MAX_ARGS) {
+    const char* pairEnd = (const char*)memchr(data, '&', end - data);
+    if (!pairEnd) pairEnd = end;
+    const char* equals = (const char*)memchr(data, '=', pairEnd - data);
+    const char* nameEnd = equals ? equals : pairEnd;
+    if (nameEnd > data) {
+      urlDecode(_argNames[_argCount], data, nameEnd - data);
+      if (equals) {
+        urlDecode(_argValues[_argCount], equals + 1, pairEnd - equals - 1);
+      } else {
+        _argValues[_argCount] = String();
+      }
+      _argCount++;
+    }
+    data = pairEnd + 1;
+  }
+}
+
+// dispatch(HttpConnection& conn)
+// Runs the handler for the complete request in conn and finishes its response.
+// - 400 if the request is malformed, the not-found handler (default 404) if no route matches, and 500 if
+//   the handler sent nothing. A chunked response the handler left open is ended here.
+
+void AsyncHttpServer::dispatch(HttpConnection& conn)
+{
+  _current = &conn;
+  conn.lastActivity = millis();
+  if (conn.requestCount > 0) {
+    _stats.connectionReuses++;
+  }
+  if (!parseRequest(conn)) {
+    send(400, "text/plain", statusText(400));
+  } else {
+    Route* route = findRoute(_method, _uri.c_str(), _uri.length());
+    _body.begin(conn.streamBody ? conn.body : nullptr, conn.bodyLength);
+    if (route) {
+      route->handler();
+    } else if (_notFoundHandler) {
+      _notFoundHandler();
+    } else {
+      send(404, "text/plain", String("Not found: ") + _uri);
+    }
+    if (!_responseStarted) {
+      send(500, "text/plain", "Handler sent no response");
+    } else if (!_responseFinished) {
+      if (_chunked) {
+        sendContent("");
+      } else {
+        finishResponse();
+      }
+    }
+  }
+  _body.begin(nullptr, 0);
+  _stats.requestsServed++;
+  conn.requestCount++;
+  freeBody(conn);
+  resetRequest();
+  _current = nullptr;
+  if (!conn.pcb) {
+    releaseConnection(conn); // Client went away while the handler ran
+  }
+}
+
+// sendError(HttpConnection& conn, int code)
+// Answers a request that could not be read (too large, unsupported) with a plain-text error and closes.
+
+void AsyncHttpServer::sendError(HttpConnection& conn, int code)
+{
+  _current = &conn;
+  conn.keepAlive = false;
+  send(code, "text/plain", statusText(code));
+  resetRequest();
+  _current = nullptr;
+}
+
+// beginResponse(int code, const char* contentType, size_t contentLength)
+// Writes the status line and headers. CONTENT_LENGTH_UNKNOWN selects chunked transfer encoding.
+// Persistent connections announce the idle timeout and the requests left (Keep-Alive header).
+
+void AsyncHttpServer::beginResponse(int code, const char* contentType, size_t contentLength)
+{
+  _responseStarted = true;
+  _chunked = contentLength == CONTENT_LENGTH_UNKNOWN;
+  char line[64];
+  snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", code, statusText(code));
+  write(line);
+  if (contentType && *contentType) {
+    write("Content-Type: ");
+    write(contentType);
+    write("\r\n");
+  }
+  if (_chunked) {
+    write("Transfer-Encoding: chunked\r\n");
+  } else {
+    snprintf(line, sizeof(line), "Content-Length: %u\r\n", (unsigned)contentLength);
+    write(line);
+  }
+  if (_current->keepAlive) {
+    snprintf(line, sizeof(line), "Connection: keep-alive\r\nKeep-Alive: timeout=%u, max=%u\r\n",
+             (unsigned)(_keepAliveTimeout / 1000), (unsigned)(_keepAliveMax - _current->requestCount - 1));
+    write(line);
+  } else {
+    write("Connection: close\r\n");
+  }
+  write(_responseHeaders.c_str(), _responseHeaders.length());
+  _responseHeaders = String();
+  write("\r\n");
+}
+
+// finishResponse()
+// Marks the response complete; the rest is sent from drain() and the connection closed once it is out.
+
+void AsyncHttpServer::finishResponse()
+{
+  _responseFinished = true;
+  _current->state = HTTP_CONN_SENDING;
+  drain(*_current);
+}
+
+// write(const char* data, size_t length)
+// Appends response bytes to the current connection's TX buffer, never waiting for the client.
+// - When the buffer is full, hands it to lwIP (drain()); what lwIP cannot take yet goes to the connection's
+//   TX queue, one HttpTxSegment at a time, and is sent later by drain() from the sent callback and
+//   handleClient(). A slow reader thus costs queued memory, not time in the handler.
+// - Segments come out of HTTP_BUFFER_BUDGET. If the budget (or the heap) is exhausted, the response is cut
+//   off: the connection is reset and counted in responsesCut.
+// - Output for a connection that is gone is dropped.
+
+void AsyncHttpServer::write(const char* data, size_t length)
+{
+  HttpConnection& conn = *_current;
+  while (length > 0 && conn.pcb) {
+    if (!conn.txQueue && conn.txLength == HTTP_TX_BUFFER_SIZE) {
+      drain(conn);
+    }
+    uint8_t* target;
+    size_t* used;
+    if (!conn.txQueue && conn.txLength < HTTP_TX_BUFFER_SIZE) {
+      target = conn.txBuffer;
+      used = &conn.txLength;
+    } else {
+      HttpTxSegment* tail = conn.txQueueTail;
+      if (!tail || tail->length == HTTP_TX_BUFFER_SIZE) {
+        tail = nullptr;
+        if (reserveBuffer(sizeof(HttpTxSegment))) {
+          tail = (HttpTxSegment*)malloc(sizeof(HttpTxSegment));
+          if (!tail) releaseBuffer(sizeof(HttpTxSegment));
+        }
+        if (!tail) {
+          _stats.responsesCut++;
+          httpTransportAbort(conn);
+          return;
+        }
+        tail->next = nullptr;
+        tail->length = 0;
+        if (conn.txQueueTail) {
+          conn.txQueueTail->next = tail;
+        } else {
+          conn.txQueue = tail;
+        }
+        conn.txQueueTail = tail;
+      }
+      target = tail->data;
+      used = &tail->length;
+    }
+    size_t count = std::min(length, (size_t)HTTP_TX_BUFFER_SIZE - *used);
+    memcpy(target + *used, data, count);
+    *used += count;
+    data += count;
+    length -= count;
+  }
+}
+
+// reserveBuffer(size_t size) / releaseBuffer(size_t size)
+// Takes size bytes from HTTP_BUFFER_BUDGET (false if they do not fit) and gives them back.
+
+bool AsyncHttpServer::reserveBuffer(size_t size)
+{
+  if (_stats.bufferedBytes + size > HTTP_BUFFER_BUDGET) return false;
+  _stats.bufferedBytes += size;
+  _stats.peakBufferedBytes = std::max(_stats.peakBufferedBytes, _stats.bufferedBytes);
+  return true;
+}
+
+void AsyncHttpServer::releaseBuffer(size_t size)
+{
+  _stats.bufferedBytes -= size;
+}
+
+// freeBody(HttpConnection& conn) / freeTxQueue(HttpConnection& conn)
+// Free the request body and the queued output of conn and return their bytes to the budget.
+
+void AsyncHttpServer::freeBody(HttpConnection& conn)
+{
+  if (!conn.body) return;
+  free(conn.body);
+  conn.body = nullptr;
+  releaseBuffer(conn.contentLength + 1);
+}
+
+void AsyncHttpServer::freeTxQueue(HttpConnection& conn)
+{
+  while (conn.txQueue) {
+    HttpTxSegment* segment = conn.txQueue;
+    conn.txQueue = segment->next;
+    free(segment);
+    releaseBuffer(sizeof(HttpTxSegment));
+  }
+  conn.txQueueTail = nullptr;
+}
+
+// drain(HttpConnection& conn)
+// Hands as much pending output to lwIP as it accepts: first the TX buffer, then the TX queue and then any
+// flash body from send_P(), both staged through the TX buffer. Called from the handler side, from
+// handleClient() and from the sent callback.
+
+void AsyncHttpServer::drain(HttpConnection& conn)
+{
+  bool progress = false;
+  while (conn.pcb) {
+    if (conn.txLength == 0 && conn.txQueue) {
+      HttpTxSegment* segment = conn.txQueue;
+      memcpy(conn.txBuffer, segment->data, segment->length);
+      conn.txLength = segment->length;
+      conn.txQueue = segment->next;
+      if (!conn.txQueue) conn.txQueueTail = nullptr;
+      free(segment);
+      releaseBuffer(sizeof(HttpTxSegment));
+    } else if (conn.txLength == 0 && conn.txFlashLength > 0) {
+      size_t count = std::min(conn.txFlashLength, (size_t)HTTP_TX_BUFFER_SIZE);
+      memcpy_P(conn.txBuffer, conn.txFlash, count);
+      conn.txFlash += count;
+      conn.txFlashLength -= count;
+      conn.txLength = count;
+    }
+    if (conn.txLength == 0) break;
+    size_t count = httpTransportWrite(conn, conn.txBuffer, conn.txLength);
+    if (count == 0) break;
+    conn.txLength -= count;
+    memmove(conn.txBuffer, conn.txBuffer + count, conn.txLength);
+    progress = true;
+  }
+  if (progress) {
+    conn.lastActivity = millis();
+    httpTransportFlush(conn);
+  }
+}
+
+// startNextRequest(HttpConnection& conn)
+// Readies a persistent connection for its next request once the response is out. Bytes the client already
+// sent beyond the current request (pipelining) are kept and parsed on the next handleClient().
+
+void AsyncHttpServer::startNextRequest(HttpConnection& conn)
+{
+  size_t leftover = conn.rxLength - conn.requestLength;
+  memmove(conn.rxBuffer, conn.rxBuffer + conn.requestLength, leftover);
+  conn.rxLength = leftover;
+  conn.rxBuffer[leftover] = '\0';
+  conn.pipelined = leftover > 0;
+  conn.headLength = 0;
+  conn.requestLength = 0;
+  conn.bodyLength = 0;
+  conn.contentLength = 0;
+  conn.keepAlive = false;
+  conn.state = HTTP_CONN_READING;
+  conn.lastActivity = millis();
+  conn.requestStart = conn.lastActivity;
+}
+
+// evictIdleConnection()
+// Closes the persistent connection that has been idle longest (no request in progress) and returns its
+// slot, or nullptr if every connection is busy.
+
+HttpConnection* AsyncHttpServer::evictIdleConnection()
+{
+  HttpConnection* oldest = nullptr;
+  for (HttpConnection& conn : _connections) {
+    bool idle = conn.state == HTTP_CONN_READING && conn.requestCount > 0 && conn.rxLength == 0 && !conn.rxPending;
+    if (idle && (!oldest || (long)(conn.lastActivity - oldest->lastActivity) < 0)) {
+      oldest = &conn;
+    }
+  }
+  if (oldest) {
+    closeConnection(*oldest);
+    _stats.idleEvictions++;
+  }
+  return oldest;
+}
+
+// closeConnection(HttpConnection& conn) / releaseConnection(HttpConnection& conn)
+// Closes the TCP connection gracefully and frees the slot; releaseConnection() only frees the slot and its
+// buffers (for connections the transport has already closed).
+
+void AsyncHttpServer::closeConnection(HttpConnection& conn)
+{
+  httpTransportClose(conn);
+  releaseConnection(conn);
+}
+
+void AsyncHttpServer::releaseConnection(HttpConnection& conn)
+{
+  freeBody(conn);
+  freeTxQueue(conn);
+  free(conn.rxBuffer);
+  free(conn.txBuffer);
+  conn = HttpConnection();
+}
+
+// resetRequest()
+// Clears the request and response state between requests and releases the heap held by arg Strings.
+
+void AsyncHttpServer::resetRequest()
+{
+  _method = HTTP_GET;
+  _uri = String();
+  for (int i = 0; i < _argCount; i++) {
+    _argNames[i] = String();
+    _argValues[i] = String();
+  }
+  _argCount = 0;
+  for (size_t i = 0; i < _headerCount; i++) {
+    _headerValues[i] = String();
+  }
+  _responseHeaders = String();
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+  _responseStarted = false;
+  _responseFinished = false;
+  _chunked = false;
+  _headersOnly = false;
+}
+
+// HttpBodyStream
+// The request body of an onStream() route: a read cursor over the body buffer of the connection, which
+// holds the complete body by the time the handler runs.
+
+void HttpBodyStream::begin(const char* data, size_t length)
+{
+  _data = data;
+  _remaining = data ? length : 0;
+}
+
+int HttpBodyStream::available()
+{
+  return _remaining;
+}
+
+int HttpBodyStream::read()
+{
+  if (_remaining == 0) return -1;
+  _remaining--;
+  return (uint8_t)*_data++;
+}
+
+int HttpBodyStream::peek()
+{
+  return _remaining ? (uint8_t)*_data : -1;
+}
+
+size_t HttpBodyStream::readBytes(char* buffer, size_t length)
+{
+  size_t count = std::min(length, _remaining);
+  memcpy(buffer, _data, count);
+  _data += count;
+  _remaining -= count;
+  return count;
+}
@@ -0,0 +1,278 @@
+// =====================================================================
+// AsyncHttpServer
+// =====================================================================
+// Event-driven HTTP/1.1 server for the ESP8266, built on the lwIP raw TCP API.
+// - Up to HTTP_MAX_CONNECTIONS clients are served at once. The TCP callbacks only move bytes between lwIP
+//   and small per-connection buffers, so a slow client never blocks other clients or loop().
+// - Complete requests are dispatched from handleClient() in loop(), one per connection per call. Handlers
+//   therefore run in the normal sketch context and may use delay(), flash writes and ESP.restart().
+// - The handler API is the subset of ESP8266WebServer the sketch uses (on, arg, header, send, sendContent,
+//   ...), so handlers work unchanged on either server.
+// - Connections are persistent (HTTP/1.1 keep-alive) and pipelined requests are answered in order; see
+//   setKeepAlive(). When all slots are taken, an idle persistent connection is closed to admit a new client.
+// - Handlers never wait for a client to take their output. What lwIP and the TX buffer cannot take yet is
+//   queued (see HttpTxSegment) and sent from the sent callback and handleClient(), so a slow reader of a
+//   large page holds up neither loop() nor the other clients.
+// - Memory is bounded. Each connection holds HTTP_RX_BUFFER_SIZE for the request head and HTTP_TX_BUFFER_SIZE
+//   for output not yet accepted by lwIP. Request bodies (at most HTTP_MAX_BODY_SIZE each) and queued output
+//   share HTTP_BUFFER_BUDGET across all connections. Worst case with the defaults and 4 connections:
+//   4 x (1024 + 1460) + 12288 = 22224 bytes of heap, plus the arg and header Strings of the request being
+//   handled. Unread request data stays in lwIP, whose receive window then throttles the client; a body also
+//   waits there until the budget has room for it.
+// - A handler only runs once its whole request (head and body) is in, so it never waits for the client.
+//   A request must arrive within HTTP_REQUEST_MAX_TIME in total, so a client that trickles bytes cannot
+//   hold a connection slot indefinitely either.
+// - Routes registered with onStream() get their body as a Stream (body()) over the received body, e.g. for
+//   deserializeJson(), or one form field decoded in place (formField()), instead of as args (String copies
+//   of every field).
+// - The transport (accept/read/write/close) lives in HttpTransport*.cpp.
+//
+// The limits below can be overridden with build_flags in platformio.ini.
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 4        // Concurrent client connections; further connects are refused
+#endif
+#ifndef HTTP_RX_BUFFER_SIZE
+#define HTTP_RX_BUFFER_SIZE 1024      // Request line + headers must fit (else 431)
+#endif
+#ifndef HTTP_TX_BUFFER_SIZE
+#define HTTP_TX_BUFFER_SIZE 1460      // One TCP segment of response data waiting for lwIP
+#endif
+#ifndef HTTP_MAX_BODY_SIZE
+#define HTTP_MAX_BODY_SIZE 6400       // Largest request body accepted (else 413); holds a 2 KB form value
+                                      // even if every byte is URL-encoded (%XX)
+#endif
+#ifndef HTTP_BUFFER_BUDGET
+#define HTTP_BUFFER_BUDGET 12288      // Request bodies and queued response output of all connections together;
+                                      // a response that would exceed it is cut off
+#endif
+#ifndef HTTP_MAX_ARGS
+#define HTTP_MAX_ARGS 16              // Query and form arguments kept per request
+#endif
+#ifndef HTTP_MAX_HEADERS
+#define HTTP_MAX_HEADERS 4            // Request headers that can be collected for handlers
+#endif
+#ifndef HTTP_REQUEST_TIMEOUT
+#define HTTP_REQUEST_TIMEOUT 5000     // ms without progress while reading a request
+#endif
+#ifndef HTTP_REQUEST_MAX_TIME
+#define HTTP_REQUEST_MAX_TIME 15000   // ms a request may take to arrive in full, however steadily it trickles in
+#endif
+#ifndef HTTP_SEND_TIMEOUT
+#define HTTP_SEND_TIMEOUT 5000        // ms without progress while sending a response
+#endif
+#ifndef HTTP_KEEP_ALIVE_TIMEOUT
+#define HTTP_KEEP_ALIVE_TIMEOUT 5000  // ms an idle persistent connection is kept open (0 disables keep-alive)
+#endif
+#ifndef HTTP_KEEP_ALIVE_MAX
+#define HTTP_KEEP_ALIVE_MAX 20        // Requests served on one connection before it is closed
+#endif
+
+#ifndef CONTENT_LENGTH_UNKNOWN
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+#endif
+#ifndef CONTENT_LENGTH_NOT_SET
+#define CONTENT_LENGTH_NOT_SET ((size_t) -2)
+#endif
+
+// Same names and values as ESP8266WebServer, so handlers compile against either server.
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+
+class AsyncHttpServer;
+
+// Lifecycle of a connection slot:
+// - HTTP_CONN_FREE: Slot unused.
+// - HTTP_CONN_READING: Receiving a request head or body.
+// - HTTP_CONN_SENDING: The handler has finished its response; draining it to lwIP before the connection
+//   is closed or, with keep-alive, goes back to HTTP_CONN_READING for the next request.
+enum HttpConnectionState {
+  HTTP_CONN_FREE,
+  HTTP_CONN_READING,
+  HTTP_CONN_SENDING
+};
+
+// Response output queued behind the TX buffer while lwIP cannot take it; one link of a per-connection list.
+struct HttpTxSegment {
+  HttpTxSegment* next;
+  size_t length;
+  uint8_t data[HTTP_TX_BUFFER_SIZE];
+};
+
+// One client connection. Owned by AsyncHttpServer; the transport only touches pcb, rxPending and
+// rxPendingOffset, and reports events through the AsyncHttpServer::connection*() callbacks.
+struct HttpConnection {
+  AsyncHttpServer* server;
+  HttpConnectionState state;
+  void* pcb;                          // Transport handle (tcp_pcb* on lwIP), nullptr once closed
+  void* rxPending;                    // Received data not yet read (pbuf chain on lwIP)
+  size_t rxPendingOffset;             // Bytes of the first pending pbuf already read
+  bool peerClosed;                    // The client has sent FIN
+  char* rxBuffer;                     // Request head, plus any bytes received after it
+  size_t rxLength;
+  size_t headLength;                  // Length of the complete head in rxBuffer, 0 while still reading it
+  size_t requestLength;               // Bytes of rxBuffer used by the current request (head and body)
+  bool pipelined;                     // rxBuffer holds unparsed bytes of the next request
+  char* body;                         // Request body (contentLength bytes), nullptr if none
+  size_t bodyLength;                  // Body bytes received so far
+  bool streamBody;                    // The route reads the body itself (onStream()); no args from the body
+  size_t contentLength;
+  uint8_t* txBuffer;                  // Response bytes not yet accepted by lwIP
+  size_t txLength;
+  HttpTxSegment* txQueue;             // Output written while txBuffer was full, sent after it
+  HttpTxSegment* txQueueTail;
+  const uint8_t* txFlash;             // PROGMEM body queued by send_P(), sent after txBuffer
+  size_t txFlashLength;
+  bool keepAlive;                     // Keep the connection open after the current response
+  uint16_t requestCount;              // Requests completed on this connection
+  unsigned long lastActivity;
+  unsigned long requestStart;         // When the first byte of the current request arrived
+};
+
+// Counters since begin() and the current buffer use, for /status and benchmarks.
+struct HttpServerStats {
+  uint32_t connectionsAccepted;
+  uint32_t connectionsRejected;       // No free slot or out of memory
+  uint32_t requestsServed;
+  uint32_t connectionReuses;          // Requests that arrived on an already used (keep-alive) connection
+  uint32_t idleEvictions;             // Idle persistent connections closed to admit a new client
+  uint32_t timeouts;                  // Connections dropped by HTTP_REQUEST_TIMEOUT, HTTP_REQUEST_MAX_TIME or
+                                      // HTTP_SEND_TIMEOUT
+  uint32_t responsesCut;              // Responses aborted because their output did not fit HTTP_BUFFER_BUDGET
+  uint32_t bufferedBytes;             // Bytes of HTTP_BUFFER_BUDGET in use (bodies and queued output)
+  uint32_t peakBufferedBytes;
+  uint8_t peakConnections;
+};
+
+// Request body of an onStream() route, as a Stream for deserializeJson() and similar readers.
+// The whole body has been received before the handler runs, so reads never wait; available() is the number
+// of body bytes not yet read.
+class HttpBodyStream : public Stream {
+public:
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  friend class AsyncHttpServer;
+  void begin(const char* data, size_t length);
+
+  const char* _data = nullptr;
+  size_t _remaining = 0;
+};
+
+class AsyncHttpServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit AsyncHttpServer(uint16_t port = 80);
+
+  void begin();
+  void handleClient();
+
+  // Routing
+  void on(const String& uri, THandlerFunction handler);
+  void on(const String& uri, HTTPMethod method, THandlerFunction handler);
+  void onStream(const String& uri, HTTPMethod method, THandlerFunction handler);
+  void onNotFound(THandlerFunction handler);
+  void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+  void setKeepAlive(unsigned long idleTimeout, uint16_t maxRequests);
+
+  // Request (valid inside a handler)
+  HTTPMethod method() const { return _method; }
+  const String& uri() const { return _uri; }
+  String arg(const String& name) const;
+  bool hasArg(const String& name) const;
+  int args() const { return _argCount; }
+  String header(const String& name) const;
+  bool hasHeader(const String& name) const;
+  Stream& body() { return _body; }
+  char* formField(const char* name);
+  size_t bodyLength() const { return _current ? _current->contentLength : 0; }
+
+  // Response (valid inside a handler)
+  void sendHeader(const String& name, const String& value, bool first = false);
+  void setContentLength(size_t contentLength) { _contentLength = contentLength; }
+  void send(int code, const char* contentType = nullptr, const char* content = "");
+  void send(int code, const char* contentType, const String& content);
+  void send(int code, const char* contentType, const char* content, size_t length);
+  void send_P(int code, const char* contentType, PGM_P content, size_t length);
+  void sendContent(const char* content, size_t length);
+  void sendContent(const char* content) { sendContent(content, strlen(content)); }
+  void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+
+  const HttpServerStats& stats() const { return _stats; }
+  uint8_t activeConnections() const;
+
+  // Transport callbacks (see HttpTransport.h)
+  HttpConnection* connectionAccepted(void* pcb);
+  void connectionSent(HttpConnection& conn);
+  void connectionClosed(HttpConnection& conn);
+
+private:
+  struct Route {
+    String uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+    bool streamBody;
+    Route* next;
+  };
+
+  void addRoute(const String& uri, HTTPMethod method, THandlerFunction handler, bool streamBody);
+  Route* findRoute(HTTPMethod method, const char* path, size_t length) const;
+  bool readRequest(HttpConnection& conn);
+  bool parseRequest(HttpConnection& conn);
+  void parseArgs(const char* data, size_t length);
+  void dispatch(HttpConnection& conn);
+  void sendError(HttpConnection& conn, int code);
+  void beginResponse(int code, const char* contentType, size_t contentLength);
+  void finishResponse();
+  void write(const char* data, size_t length);
+  void write(const char* text) { write(text, strlen(text)); }
+  bool reserveBuffer(size_t size);
+  void releaseBuffer(size_t size);
+  void freeBody(HttpConnection& conn);
+  void freeTxQueue(HttpConnection& conn);
+  void drain(HttpConnection& conn);
+  void startNextRequest(HttpConnection& conn);
+  HttpConnection* evictIdleConnection();
+  void closeConnection(HttpConnection& conn);
+  void releaseConnection(HttpConnection& conn);
+  void resetRequest();
+
+  uint16_t _port;
+  void* _listener;
+  HttpConnection _connections[HTTP_MAX_CONNECTIONS];
+  Route* _firstRoute;
+  Route* _lastRoute;
+  THandlerFunction _notFoundHandler;
+  unsigned long _keepAliveTimeout;
+  uint16_t _keepAliveMax;
+  HttpServerStats _stats;
+
+  // State of the request being dispatched; only one handler runs at a time.
+  HttpConnection* _current;
+  HTTPMethod _method;
+  String _uri;
+  String _argNames[HTTP_MAX_ARGS];
+  String _argValues[HTTP_MAX_ARGS];
+  int _argCount;
+  String _headerNames[HTTP_MAX_HEADERS];
+  String _headerValues[HTTP_MAX_HEADERS];
+  size_t _headerCount;
+  HttpBodyStream _body;
+
+  // State of the response being built.
+  String _responseHeaders;
+  size_t _contentLength;
+  bool _responseStarted;
+  bool _responseFinished;
+  bool _chunked;
+  bool _headersOnly;                  // HEAD request: the body is dropped
+};
@@ -0,0 +1,51 @@
+// =====================================================================
+// HttpLoopback
+// =====================================================================
+// In-process clients of AsyncHttpServer for host builds (env:native), where HttpTransportLoopback.cpp takes
+// the place of lwIP: request bytes go straight into the connection's receive queue and the server's output is
+// appended to the client's buffer. Tests, benchmarks and load generators drive the real server and handlers
+// with it, without sockets.
+// - Nothing moves until the server runs: call server.handleClient() (or the sketch's loop()) after send().
+// - The send window models the TCP send buffer: the server can have at most that many response bytes in
+//   received() at once; consume() makes room again. Unlimited by default.
+// - Destroying a connected client resets the connection, like a client that vanished.
+
+#pragma once
+
+#include "AsyncHttpServer.h"
+#include "HttpTransport.h"
+#include <string>
+
+class HttpLoopbackClient {
+public:
+  HttpLoopbackClient() {}
+  ~HttpLoopbackClient();
+  HttpLoopbackClient(const HttpLoopbackClient&) = delete;
+  HttpLoopbackClient& operator=(const HttpLoopbackClient&) = delete;
+
+  bool connect(uint16_t port = 80);   // false if nothing listens on port or the server refused the client
+  void send(const char* data, size_t length);
+  void send(const std::string& data) { send(data.data(), data.size()); }
+  void finish();                      // No more request data (FIN)
+  void abort();                       // Reset the connection
+  bool connected() const { return _conn != nullptr; }  // Until the server closes the connection
+  bool reset() const { return _reset; }                // The server aborted the connection
+
+  const std::string& received() const { return _received; }
+  void consume(size_t length);        // Drops length bytes from the front of received()
+  size_t responseLength() const;      // Bytes of the first complete response in received(), 0 if incomplete
+  void setSendWindow(size_t bytes);
+
+private:
+  friend size_t httpTransportRead(HttpConnection& conn, char* dest, size_t size);
+  friend size_t httpTransportWrite(HttpConnection& conn, const uint8_t* data, size_t length);
+  friend void httpTransportClose(HttpConnection& conn);
+  friend void httpTransportAbort(HttpConnection& conn);
+
+  HttpConnection* _conn = nullptr;
+  std::string _pending;               // Request bytes not yet read by the server
+  size_t _pendingOffset = 0;
+  std::string _received;
+  size_t _window = (size_t)-1;
+  bool _reset = false;
+};
@@ -0,0 +1,32 @@
+// =====================================================================
+// HttpTransport
+// =====================================================================
+// The TCP layer under AsyncHttpServer. HttpTransportLwip.cpp implements it on the lwIP raw API; host builds
+// use HttpTransportLoopback.cpp, whose connections come from HttpLoopbackClient (HttpLoopback.h).
+// - The transport calls AsyncHttpServer::connectionAccepted() for each new client, connectionSent() when
+//   lwIP has room for more output, and connectionClosed() when the connection is gone (error or reset).
+// - Received data is queued on HttpConnection::rxPending and only acknowledged to the peer (window update)
+//   when AsyncHttpServer reads it with httpTransportRead().
+// - None of these functions block.
+
+#pragma once
+
+#include "AsyncHttpServer.h"
+
+// Starts listening on port; returns the listener handle or nullptr on failure.
+void* httpTransportListen(AsyncHttpServer& server, uint16_t port);
+
+// Copies up to size received bytes into dest; returns the number copied.
+size_t httpTransportRead(HttpConnection& conn, char* dest, size_t size);
+
+// Queues up to length bytes for sending; returns the number accepted (0 while the send buffer is full).
+size_t httpTransportWrite(HttpConnection& conn, const uint8_t* data, size_t length);
+
+// Pushes queued output onto the network.
+void httpTransportFlush(HttpConnection& conn);
+
+// Closes the connection after the queued output (graceful); drops unread input. Clears conn.pcb.
+void httpTransportClose(HttpConnection& conn);
+
+// Resets the connection immediately. Clears conn.pcb.
+void httpTransportAbort(HttpConnection& conn);
@@ -0,0 +1,191 @@
+// =====================================================================
+// HttpTransportLoopback
+// =====================================================================
+// HttpTransport for host builds: connections come from HttpLoopbackClient (HttpLoopback.h) instead of lwIP.
+// conn.pcb points to the client; conn.rxPending is non-null while the client has bytes the server has not read.
+
+#if !defined(ARDUINO_ARCH_ESP8266)
+
+#include "HttpLoopback.h"
+#include <strings.h>
+
+static const size_t MAX_LISTENERS = 4;
+
+struct LoopbackListener {
+  AsyncHttpServer* server;
+  uint16_t port;
+};
+
+static LoopbackListener listeners[MAX_LISTENERS];
+
+void* httpTransportListen(AsyncHttpServer& server, uint16_t port)
+{
+  LoopbackListener* free = nullptr;
+  for (LoopbackListener& listener : listeners) {
+    if (listener.server && listener.port == port) {
+      listener.server = &server; // A new server on the same port replaces the old one
+      return &listener;
+    }
+    if (!listener.server && !free) free = &listener;
+  }
+  if (!free) return nullptr;
+  free->server = &server;
+  free->port = port;
+  return free;
+}
+
+size_t httpTransportRead(HttpConnection& conn, char* dest, size_t size)
+{
+  HttpLoopbackClient* client = (HttpLoopbackClient*)conn.pcb;
+  if (!client) return 0;
+  size_t count = std::min(size, client->_pending.size() - client->_pendingOffset);
+  memcpy(dest, client->_pending.data() + client->_pendingOffset, count);
+  client->_pendingOffset += count;
+  if (client->_pendingOffset == client->_pending.size()) {
+    client->_pending.clear();
+    client->_pendingOffset = 0;
+    conn.rxPending = nullptr;
+  }
+  return count;
+}
+
+size_t httpTransportWrite(HttpConnection& conn, const uint8_t* data, size_t length)
+{
+  HttpLoopbackClient* client = (HttpLoopbackClient*)conn.pcb;
+  if (!client || client->_received.size() >= client->_window) return 0;
+  size_t count = std::min(length, client->_window - client->_received.size());
+  client->_received.append((const char*)data, count);
+  return count;
+}
+
+void httpTransportFlush(HttpConnection& conn)
+{
+  (void)conn; // Written bytes are in the client's buffer already
+}
+
+void httpTransportClose(HttpConnection& conn)
+{
+  HttpLoopbackClient* client = (HttpLoopbackClient*)conn.pcb;
+  conn.pcb = nullptr;
+  conn.rxPending = nullptr;
+  if (client) client->_conn = nullptr;
+}
+
+void httpTransportAbort(HttpConnection& conn)
+{
+  HttpLoopbackClient* client = (HttpLoopbackClient*)conn.pcb;
+  httpTransportClose(conn);
+  if (client) client->_reset = true;
+}
+
+HttpLoopbackClient::~HttpLoopbackClient()
+{
+  abort();
+}
+
+bool HttpLoopbackClient::connect(uint16_t port)
+{
+  abort();
+  _pending.clear();
+  _pendingOffset = 0;
+  _received.clear();
+  _reset = false;
+  for (LoopbackListener& listener : listeners) {
+    if (listener.server && listener.port == port) {
+      _conn = listener.server->connectionAccepted(this);
+      return _conn != nullptr;
+    }
+  }
+  return false;
+}
+
+void HttpLoopbackClient::send(const char* data, size_t length)
+{
+  if (!_conn) return;
+  _pending.append(data, length);
+  if (!_pending.empty()) _conn->rxPending = this;
+}
+
+void HttpLoopbackClient::finish()
+{
+  if (_conn) _conn->peerClosed = true;
+}
+
+// abort()
+// Resets the connection from the client side: the server learns of it as lwIP would report an error.
+
+void HttpLoopbackClient::abort()
+{
+  if (!_conn) return;
+  HttpConnection* conn = _conn;
+  _conn = nullptr;
+  conn->pcb = nullptr;
+  conn->rxPending = nullptr;
+  conn->server->connectionClosed(*conn);
+}
+
+void HttpLoopbackClient::consume(size_t length)
+{
+  _received.erase(0, length);
+  if (_conn) _conn->server->connectionSent(*_conn);
+}
+
+void HttpLoopbackClient::setSendWindow(size_t bytes)
+{
+  _window = bytes;
+  if (_conn) _conn->server->connectionSent(*_conn);
+}
+
+// headerValue(const std::string& head, const char* name)
+// Returns the position of the value of header name in head, or npos.
+
+static size_t headerValue(const std::string& head, const char* name)
+{
+  size_t nameLength = strlen(name);
+  for (size_t line = head.find("\r\n"); line != std::string::npos; line = head.find("\r\n", line + 2)) {
+    size_t start = line + 2;
+    if (head.size() > start + nameLength && strncasecmp(head.c_str() + start, name, nameLength) == 0 &&
+        head[start + nameLength] == ':') {
+      size_t value = start + nameLength + 1;
+      while (value < head.size() && head[value] == ' ') value++;
+      return value;
+    }
+  }
+  return std::string::npos;
+}
+
+// responseLength()
+// Frames the first response in received(): by Content-Length, by the chunked terminator, or (for neither) by
+// the server closing the connection. 1xx, 204 and 304 responses have no body. Responses to HEAD are not
+// recognised (their Content-Length describes a body that is not sent).
+
+size_t HttpLoopbackClient::responseLength() const
+{
+  size_t headEnd = _received.find("\r\n\r\n");
+  if (headEnd == std::string::npos) return 0;
+  size_t bodyStart = headEnd + 4;
+  std::string head = _received.substr(0, headEnd + 2);
+  int status = head.size() > 12 ? atoi(head.c_str() + 9) : 0;
+  if ((status >= 100 && status < 200) || status == 204 || status == 304) return bodyStart;
+
+  size_t lengthPos = headerValue(head, "Content-Length");
+  if (lengthPos != std::string::npos) {
+    size_t length = strtoul(head.c_str() + lengthPos, nullptr, 10);
+    return _received.size() >= bodyStart + length ? bodyStart + length : 0;
+  }
+  size_t encodingPos = headerValue(head, "Transfer-Encoding");
+  if (encodingPos != std::string::npos && strncasecmp(head.c_str() + encodingPos, "chunked", 7) == 0) {
+    size_t pos = bodyStart;
+    for (;;) {
+      size_t lineEnd = _received.find("\r\n", pos);
+      if (lineEnd == std::string::npos) return 0;
+      size_t chunk = strtoul(_received.c_str() + pos, nullptr, 16);
+      pos = lineEnd + 2 + chunk + 2;
+      if (pos > _received.size()) return 0;
+      if (chunk == 0) return pos;
+    }
+  }
+  return _conn ? 0 : _received.size();
+}
+
+#endif // !ARDUINO_ARCH_ESP8266
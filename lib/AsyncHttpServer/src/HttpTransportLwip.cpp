@@ -0,0 +1,186 @@
+// =====================================================================
+// HttpTransportLwip
+// =====================================================================
+// HttpTransport on the lwIP raw TCP API. The callbacks run in the SDK (system) context between loop()
+// iterations and yield()/delay() calls; they never parse or run handlers, they only queue data.
+
+#if defined(ARDUINO_ARCH_ESP8266)
+
+#include "HttpTransport.h"
+#include <lwip/tcp.h>
+
+// detach(tcp_pcb* pcb)
+// Removes our callbacks so lwIP no longer reports events for a connection we are done with.
+
+static void detach(tcp_pcb* pcb)
+{
+  tcp_arg(pcb, nullptr);
+  tcp_recv(pcb, nullptr);
+  tcp_sent(pcb, nullptr);
+  tcp_err(pcb, nullptr);
+}
+
+// freePending(HttpConnection& conn)
+// Frees received data that was never read.
+
+static void freePending(HttpConnection& conn)
+{
+  if (conn.rxPending) {
+    pbuf_free((pbuf*)conn.rxPending);
+    conn.rxPending = nullptr;
+    conn.rxPendingOffset = 0;
+  }
+}
+
+// onRecv(void* arg, tcp_pcb* pcb, pbuf* p, err_t err)
+// Queues incoming data on the connection; a null pbuf means the client sent FIN.
+// The receive window is only reopened (tcp_recved) as AsyncHttpServer reads the data.
+
+static err_t onRecv(void* arg, tcp_pcb* pcb, pbuf* p, err_t err)
+{
+  HttpConnection* conn = (HttpConnection*)arg;
+  if (!conn) {
+    if (p) pbuf_free(p);
+    return ERR_OK;
+  }
+  if (!p) {
+    conn->peerClosed = true;
+    return ERR_OK;
+  }
+  if (conn->rxPending) {
+    pbuf_cat((pbuf*)conn->rxPending, p);
+  } else {
+    conn->rxPending = p;
+  }
+  return ERR_OK;
+}
+
+// onSent(void* arg, tcp_pcb* pcb, u16_t len)
+// The client acknowledged data, so lwIP has room again: let the server queue more.
+
+static err_t onSent(void* arg, tcp_pcb* pcb, u16_t len)
+{
+  HttpConnection* conn = (HttpConnection*)arg;
+  if (conn) {
+    conn->server->connectionSent(*conn);
+  }
+  return ERR_OK;
+}
+
+// onError(void* arg, err_t err)
+// The connection was reset or aborted; lwIP has already freed the pcb.
+
+static void onError(void* arg, err_t err)
+{
+  HttpConnection* conn = (HttpConnection*)arg;
+  if (conn) {
+    conn->pcb = nullptr;
+    freePending(*conn);
+    conn->server->connectionClosed(*conn);
+  }
+}
+
+// onAccept(void* arg, tcp_pcb* pcb, err_t err)
+// Takes a free connection slot for the new client, or refuses it when all slots are busy.
+
+static err_t onAccept(void* arg, tcp_pcb* pcb, err_t err)
+{
+  AsyncHttpServer* server = (AsyncHttpServer*)arg;
+  if (err != ERR_OK || !pcb) {
+    return ERR_VAL;
+  }
+  HttpConnection* conn = server->connectionAccepted(pcb);
+  if (!conn) {
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  tcp_arg(pcb, conn);
+  tcp_recv(pcb, onRecv);
+  tcp_sent(pcb, onSent);
+  tcp_err(pcb, onError);
+  tcp_nagle_disable(pcb); // Responses are already coalesced into full segments
+  return ERR_OK;
+}
+
+void* httpTransportListen(AsyncHttpServer& server, uint16_t port)
+{
+  tcp_pcb* pcb = tcp_new();
+  if (!pcb) return nullptr;
+  if (tcp_bind(pcb, IP_ANY_TYPE, port) != ERR_OK) {
+    tcp_close(pcb);
+    return nullptr;
+  }
+  tcp_pcb* listener = tcp_listen_with_backlog(pcb, HTTP_MAX_CONNECTIONS);
+  if (!listener) {
+    tcp_close(pcb);
+    return nullptr;
+  }
+  tcp_arg(listener, &server);
+  tcp_accept(listener, onAccept);
+  return listener;
+}
+
+size_t httpTransportRead(HttpConnection& conn, char* dest, size_t size)
+{
+  pbuf* p = (pbuf*)conn.rxPending;
+  if (!p || size == 0) return 0;
+  size_t count = std::min(size, (size_t)p->tot_len - conn.rxPendingOffset);
+  pbuf_copy_partial(p, dest, count, conn.rxPendingOffset);
+  conn.rxPendingOffset += count;
+  // Release the pbufs at the head of the chain that have been read completely
+  while (p && conn.rxPendingOffset >= p->len) {
+    conn.rxPendingOffset -= p->len;
+    pbuf* next = p->next;
+    if (next) pbuf_ref(next);
+    pbuf_free(p);
+    p = next;
+  }
+  conn.rxPending = p;
+  if (conn.pcb) {
+    tcp_recved((tcp_pcb*)conn.pcb, count);
+  }
+  return count;
+}
+
+size_t httpTransportWrite(HttpConnection& conn, const uint8_t* data, size_t length)
+{
+  tcp_pcb* pcb = (tcp_pcb*)conn.pcb;
+  if (!pcb) return 0;
+  size_t count = std::min(length, (size_t)tcp_sndbuf(pcb));
+  if (count == 0) return 0;
+  if (tcp_write(pcb, data, count, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+    return 0; // Segment queue full; retried from onSent()
+  }
+  return count;
+}
+
+void httpTransportFlush(HttpConnection& conn)
+{
+  if (conn.pcb) {
+    tcp_output((tcp_pcb*)conn.pcb);
+  }
+}
+
+void httpTransportClose(HttpConnection& conn)
+{
+  freePending(conn);
+  tcp_pcb* pcb = (tcp_pcb*)conn.pcb;
+  if (!pcb) return;
+  conn.pcb = nullptr;
+  detach(pcb);
+  if (tcp_close(pcb) != ERR_OK) {
+    tcp_abort(pcb);
+  }
+}
+
+void httpTransportAbort(HttpConnection& conn)
+{
+  freePending(conn);
+  tcp_pcb* pcb = (tcp_pcb*)conn.pcb;
+  if (!pcb) return;
+  conn.pcb = nullptr;
+  detach(pcb);
+  tcp_abort(pcb);
+}
+
+#endif // ARDUINO_ARCH_ESP8266
@@ -0,0 +1,219 @@
+// =====================================================================
+// JsonFieldScanner
+// =====================================================================
+// findJsonMember() tracks only string boundaries and nesting depth; a string at depth 1 followed by ':' is a
+// member key. compactJson() is a recursive-descent validator that copies each token down over the whitespace
+// before it; the write position never passes the read position, so it can work in place.
+
+#include "JsonFieldScanner.h"
+#include <ctype.h>
+#include <string.h>
+
+// skipString(const char* p)
+// p is at an opening quote; returns the position after the closing quote, or nullptr if it is missing.
+
+static const char* skipString(const char* p)
+{
+  for (p++; *p && *p != '"'; p++) {
+    if (*p == '\\' && p[1]) p++;
+  }
+  return *p ? p + 1 : nullptr;
+}
+
+static const char* skipSpace(const char* p)
+{
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+  return p;
+}
+
+// skipValue(const char* p)
+// p is at the start of a value; returns the position after it, or nullptr if the text ends first.
+
+static const char* skipValue(const char* p)
+{
+  if (*p == '"') return skipString(p);
+  if (*p != '{' && *p != '[') {
+    while (*p && !strchr(",}] \t\r\n", *p)) p++;
+    return p;
+  }
+  int depth = 0;
+  while (*p) {
+    if (*p == '"') {
+      p = skipString(p);
+      if (!p) return nullptr;
+      continue;
+    }
+    if (*p == '{' || *p == '[') depth++;
+    if ((*p == '}' || *p == ']') && --depth == 0) return p + 1;
+    p++;
+  }
+  return nullptr;
+}
+
+const char* findJsonMember(const char* json, const char* key, size_t* length)
+{
+  size_t keyLength = strlen(key);
+  int depth = 0;
+  const char* p = json;
+  while (*p) {
+    if (*p == '"') {
+      const char* name = p + 1;
+      p = skipString(p);
+      if (!p) return nullptr;
+      const char* after = skipSpace(p);
+      if (depth != 1 || *after != ':') continue;
+      if ((size_t)(p - 1 - name) == keyLength && strncmp(name, key, keyLength) == 0) {
+        const char* value = skipSpace(after + 1);
+        const char* end = skipValue(value);
+        if (!end || end == value) return nullptr;
+        *length = end - value;
+        return value;
+      }
+      p = after + 1;
+      continue;
+    }
+    if (*p == '{' || *p == '[') depth++;
+    if (*p == '}' || *p == ']') depth--;
+    p++;
+  }
+  return nullptr;
+}
+
+// Compactor
+// Read (in) and write (out) positions of compactJson() in the same buffer, and the nesting still allowed.
+
+struct Compactor {
+  char* in;
+  char* out;
+  int depth;
+};
+
+static void skipSpace(Compactor& c)
+{
+  while (*c.in == ' ' || *c.in == '\t' || *c.in == '\r' || *c.in == '\n') c.in++;
+}
+
+static void copyChar(Compactor& c)
+{
+  *c.out++ = *c.in++;
+}
+
+// copyString(Compactor& c)
+// c.in is at an opening quote; copies the string through its closing quote. Control characters must be
+// escaped, and an escape must be one of JSON's.
+
+static bool copyString(Compactor& c)
+{
+  copyChar(c);
+  for (;;) {
+    unsigned char ch = *c.in;
+    if (ch == '"') {
+      copyChar(c);
+      return true;
+    }
+    if (ch < 0x20) return false; // Also the end of the text: unterminated string
+    if (ch == '\\') {
+      copyChar(c);
+      char escape = *c.in;
+      if (escape == 'u') {
+        copyChar(c);
+        for (int i = 0; i < 4; i++) {
+          if (!isxdigit((unsigned char)*c.in)) return false;
+          copyChar(c);
+        }
+        continue;
+      }
+      if (!escape || !strchr("\"\\/bfnrt", escape)) return false;
+    }
+    copyChar(c);
+  }
+}
+
+static bool copyDigits(Compactor& c)
+{
+  if (!isdigit((unsigned char)*c.in)) return false;
+  while (isdigit((unsigned char)*c.in)) copyChar(c);
+  return true;
+}
+
+// copyNumber(Compactor& c)
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+
+static bool copyNumber(Compactor& c)
+{
+  if (*c.in == '-') copyChar(c);
+  if (*c.in == '0') {
+    copyChar(c);
+  } else if (!copyDigits(c)) {
+    return false;
+  }
+  if (*c.in == '.') {
+    copyChar(c);
+    if (!copyDigits(c)) return false;
+  }
+  if (*c.in == 'e' || *c.in == 'E') {
+    copyChar(c);
+    if (*c.in == '+' || *c.in == '-') copyChar(c);
+    if (!copyDigits(c)) return false;
+  }
+  return true;
+}
+
+static bool copyLiteral(Compactor& c, const char* word)
+{
+  size_t length = strlen(word);
+  if (strncmp(c.in, word, length) != 0) return false;
+  memmove(c.out, c.in, length);
+  c.in += length;
+  c.out += length;
+  return true;
+}
+
+// copyValue(Compactor& c)
+// Copies one value after optional whitespace; objects and arrays recurse, one level of c.depth each.
+
+static bool copyValue(Compactor& c)
+{
+  skipSpace(c);
+  char open = *c.in;
+  if (open == '"') return copyString(c);
+  if (open == 't') return copyLiteral(c, "true");
+  if (open == 'f') return copyLiteral(c, "false");
+  if (open == 'n') return copyLiteral(c, "null");
+  if (open != '{' && open != '[') return copyNumber(c);
+
+  if (c.depth == 0) return false;
+  c.depth--;
+  char close = open == '{' ? '}' : ']';
+  copyChar(c);
+  skipSpace(c);
+  if (*c.in != close) {
+    for (;;) {
+      if (open == '{') {
+        skipSpace(c);
+        if (*c.in != '"' || !copyString(c)) return false;
+        skipSpace(c);
+        if (*c.in != ':') return false;
+        copyChar(c);
+      }
+      if (!copyValue(c)) return false;
+      skipSpace(c);
+      if (*c.in != ',') break;
+      copyChar(c);
+    }
+    if (*c.in != close) return false;
+  }
+  copyChar(c);
+  c.depth++;
+  return true;
+}
+
+size_t compactJson(char* json, int maxDepth)
+{
+  Compactor c = { json, json, maxDepth };
+  if (!copyValue(c)) return 0;
+  skipSpace(c);
+  if (*c.in) return 0;
+  *c.out = '\0';
+  return c.out - json;
+}
@@ -0,0 +1,24 @@
+// =====================================================================
+// JsonFieldScanner
+// =====================================================================
+// JSON text helpers that work without building a document: no allocation, one pass.
+// - findJsonMember() finds one top-level member and stops there. For hot single-field reads and in-place edits
+//   of a document already known to be valid (the stored config); it does not validate.
+// - compactJson() validates untrusted text strictly and removes its whitespace in place, so a document can be
+//   checked and stored from the buffer it arrived in.
+// Plain C++ without Arduino dependencies, like JsonPoolAllocator.
+
+#pragma once
+
+#include <stddef.h>
+
+// Returns the raw value of member key of the top-level object in json (a string value includes its quotes)
+// and its length in *length, or nullptr if there is no such member. Keys are compared as written, so a key
+// containing escapes does not match.
+const char* findJsonMember(const char* json, const char* key, size_t* length);
+
+// Checks that json is one valid JSON value (RFC 8259: double-quoted strings, no comments or trailing commas)
+// nested at most maxDepth arrays/objects deep, and removes the whitespace between tokens in place. Returns the
+// new length, or 0 if json is not valid; json is then left partly compacted. Strings and numbers are kept as
+// written (escapes are not resolved).
+size_t compactJson(char* json, int maxDepth);
@@ -0,0 +1,175 @@
+// =====================================================================
+// JsonPoolAllocator
+// =====================================================================
+// Block layout: the pool is tiled by blocks, each an 8-byte header (total size, free flag) followed by the
+// payload; sizes are multiples of 8 so payloads stay aligned for any JSON variant.
+
+#include "JsonPoolAllocator.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const size_t ALIGNMENT = 8;
+static const size_t HEADER_SIZE = 8;
+
+struct JsonPoolAllocator::Block {
+  uint32_t size;                      // Header plus payload
+  uint32_t free;
+};
+
+// blockSize(size_t payload)
+// Returns the block size that holds payload bytes, header included and rounded up to the alignment.
+
+static size_t blockSize(size_t payload)
+{
+  return (HEADER_SIZE + payload + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// JsonPoolAllocator(void* pool, size_t size)
+// Takes over pool[0..size) (aligned internally) as one free block.
+
+JsonPoolAllocator::JsonPoolAllocator(void* pool, size_t size)
+  : _pool(nullptr), _size(0), _stats()
+{
+  static_assert(sizeof(Block) == HEADER_SIZE, "block header must keep payloads aligned");
+  uintptr_t start = ((uintptr_t)pool + ALIGNMENT - 1) & ~(uintptr_t)(ALIGNMENT - 1);
+  size_t skipped = start - (uintptr_t)pool;
+  if (size < skipped + sizeof(Block) + ALIGNMENT) return;
+  _pool = (uint8_t*)start;
+  _size = (size - skipped) & ~(ALIGNMENT - 1);
+  first()->size = _size;
+  first()->free = 1;
+}
+
+bool JsonPoolAllocator::owns(const void* ptr) const
+{
+  return ptr >= _pool && ptr < _pool + _size;
+}
+
+JsonPoolAllocator::Block* JsonPoolAllocator::first() const
+{
+  return (Block*)_pool;
+}
+
+// next(Block* block)
+// Returns the block after block, or nullptr at the end of the pool.
+
+JsonPoolAllocator::Block* JsonPoolAllocator::next(Block* block) const
+{
+  uint8_t* after = (uint8_t*)block + block->size;
+  return after < _pool + _size ? (Block*)after : nullptr;
+}
+
+// merge(Block* block)
+// Absorbs the free blocks that directly follow the free block.
+
+void JsonPoolAllocator::merge(Block* block)
+{
+  Block* following = next(block);
+  while (following && following->free) {
+    block->size += following->size;
+    following = next(block);
+  }
+}
+
+// split(Block* block, size_t size)
+// Shrinks block to size and turns the rest into a free block, if the rest can hold a payload.
+
+void JsonPoolAllocator::split(Block* block, size_t size)
+{
+  if (block->size - size < sizeof(Block) + ALIGNMENT) return;
+  Block* rest = (Block*)((uint8_t*)block + size);
+  rest->size = block->size - size;
+  rest->free = 1;
+  block->size = size;
+  merge(rest);
+}
+
+// allocate(size_t size)
+// First fit in the pool (merging free neighbours on the way); malloc() if nothing fits.
+
+void* JsonPoolAllocator::allocate(size_t size)
+{
+  _stats.allocations++;
+  size_t needed = blockSize(size);
+  for (Block* block = _pool ? first() : nullptr; block; block = next(block)) {
+    if (!block->free) continue;
+    merge(block);
+    if (block->size < needed) continue;
+    split(block, needed);
+    block->free = 0;
+    _stats.used += block->size;
+    if (_stats.used > _stats.peakUsed) _stats.peakUsed = _stats.used;
+    return block + 1;
+  }
+  _stats.heapFallbacks++;
+  return malloc(size);
+}
+
+void JsonPoolAllocator::deallocate(void* ptr)
+{
+  if (!owns(ptr)) {
+    free(ptr);
+    return;
+  }
+  Block* block = (Block*)ptr - 1;
+  block->free = 1;
+  _stats.used -= block->size;
+  merge(block);
+}
+
+// reallocate(void* ptr, size_t newSize)
+// Resizes in place when the block shrinks or its free neighbour has room; otherwise moves the data.
+
+void* JsonPoolAllocator::reallocate(void* ptr, size_t newSize)
+{
+  if (!ptr) return allocate(newSize);
+  if (!owns(ptr)) return realloc(ptr, newSize);
+
+  Block* block = (Block*)ptr - 1;
+  size_t needed = blockSize(newSize);
+  size_t oldSize = block->size;
+  Block* following = next(block);
+  if (needed > block->size && following && following->free) {
+    merge(following);
+    if (block->size + following->size >= needed) {
+      block->size += following->size;
+    }
+  }
+  if (block->size >= needed) {
+    split(block, needed);
+    _stats.used += block->size;
+    _stats.used -= oldSize;
+    if (_stats.used > _stats.peakUsed) _stats.peakUsed = _stats.used;
+    return ptr;
+  }
+
+  void* moved = allocate(newSize);
+  if (!moved) return nullptr;
+  memcpy(moved, ptr, block->size - sizeof(Block));
+  deallocate(ptr);
+  return moved;
+}
+
+// largestFreeBlock()
+// Returns the largest payload a single allocation can get from the pool right now.
+
+size_t JsonPoolAllocator::largestFreeBlock() const
+{
+  size_t largest = 0;
+  size_t run = 0;
+  for (Block* block = _pool ? first() : nullptr; block; block = next(block)) {
+    run = block->free ? run + block->size : 0;
+    if (run > largest) largest = run;
+  }
+  return largest > sizeof(Block) ? largest - sizeof(Block) : 0;
+}
+
+// fragmentation()
+// Percentage of the free pool memory that is not in the largest free block.
+
+uint8_t JsonPoolAllocator::fragmentation() const
+{
+  size_t freeBytes = _size - _stats.used;
+  if (freeBytes <= sizeof(Block)) return 0;
+  return 100 - (uint8_t)(largestFreeBlock() * 100 / (freeBytes - sizeof(Block)));
+}
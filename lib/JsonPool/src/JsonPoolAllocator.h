@@ -0,0 +1,56 @@
+// =====================================================================
+// JsonPoolAllocator
+// =====================================================================
+// ArduinoJson v7 Allocator that serves JsonDocument memory from a fixed, caller-provided pool instead of the
+// heap. Documents live only for the duration of a request, so every allocation of a request is freed again
+// before the next one; confined to the pool, their varying sizes (variant pools, strings growing while they
+// are parsed, shrinkToFit) can no longer split the heap into ever smaller free blocks.
+// - First fit over blocks that tile the pool; freed neighbours are merged, so an idle pool is one free block.
+// - Strings that grow (reallocate) extend into a free neighbour in place when they can.
+// - If the pool is exhausted, the allocation falls back to malloc() and is counted, so a document still
+//   parses; size the pool so that heapFallbacks stays 0.
+// - Not interrupt or thread safe; use it from the sketch (loop) context only.
+// Plain C++ without Arduino dependencies, so the same code runs in host-side tests (tools/json_pool_soak.cpp).
+
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Usage counters of the pool, for /status and the soak test.
+struct JsonPoolStats {
+  uint32_t allocations;
+  uint32_t heapFallbacks;             // Allocations the pool could not hold, served by malloc() instead
+  size_t used;                        // Bytes in allocated blocks, headers included
+  size_t peakUsed;
+};
+
+class JsonPoolAllocator : public ArduinoJson::Allocator {
+public:
+  JsonPoolAllocator(void* pool, size_t size);
+
+  void* allocate(size_t size) override;
+  void deallocate(void* ptr) override;
+  void* reallocate(void* ptr, size_t newSize) override;
+
+  size_t size() const { return _size; }
+  size_t largestFreeBlock() const;
+  uint8_t fragmentation() const;      // 0..100, like ESP.getHeapFragmentation()
+  const JsonPoolStats& stats() const { return _stats; }
+  // Restarts peakUsed from the current usage, or from peak if that is higher (to put back a saved peak).
+  void resetPeak(size_t peak = 0) { _stats.peakUsed = peak > _stats.used ? peak : _stats.used; }
+
+private:
+  struct Block;
+
+  bool owns(const void* ptr) const;
+  Block* first() const;
+  Block* next(Block* block) const;
+  void merge(Block* block);
+  void split(Block* block, size_t size);
+
+  uint8_t* _pool;
+  size_t _size;
+  JsonPoolStats _stats;
+};
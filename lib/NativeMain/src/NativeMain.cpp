@@ -0,0 +1,126 @@
+// =====================================================================
+// NativeMain
+// =====================================================================
+// Default main() of the host build: runs one boot of the sketch (setup(), then loop() until the virtual
+// time limit or ESP.restart()). Host programs that drive the sketch themselves define their own main(),
+// which replaces this weak one.
+// - This library is its own archive (library.json), apart from lib/NativeShims, so the linker only takes
+//   NativeMain.o when nothing else defines main(). A program with its own main(), e.g. the unit tests
+//   (pio test -e native, built without src/), then needs no setup() or loop().
+// - main() stays weak for libFuzzer, whose runtime is linked whole and brings a strong main() after it.
+//
+//   program [options]
+//   --ms N            Virtual run time in ms (default 15000)
+//   --flash FILE      Flash image (NATIVE_FLASH_SIZE bytes) to load and save back; erased chip if missing
+//   --rtc FILE        RTC user memory to load and save back, for a --soft-restart boot
+//   --soft-restart    Boot as after ESP.restart() (default: power-on)
+//   --wifi OUTCOME    connect, nossid, wrongpass or silent for the first WiFi.begin() (repeatable, in order)
+//   --button MS       Hold GPIO0 (the template's button) low for MS ms, starting 1 s after boot
+//   --get PATH        GET PATH over the loopback once setup() is done and print the response (repeatable)
+//   --quiet           Discard Serial output
+// Exits with 3 if the boot ended in ESP.restart() (run again with --soft-restart to continue), 0 otherwise.
+
+#include "Arduino.h"
+#include <HttpLoopback.h>
+#include <vector>
+
+void setup();
+void loop();
+
+// runGet(const char* path, unsigned long until)
+// Sends one GET through a loopback client and runs loop() until the response is complete.
+
+static void runGet(const char* path, unsigned long until)
+{
+  HttpLoopbackClient client;
+  if (!client.connect(80)) {
+    printf("[native] GET %s: no server listening\n", path);
+    return;
+  }
+  std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n\r\n";
+  client.send(request);
+  while (!client.responseLength() && client.connected() && millis() < until) {
+    loop();
+    nativePump();
+  }
+  printf("[native] GET %s after %lu ms:\n%.*s\n", path, millis(), (int)client.responseLength(),
+         client.received().c_str());
+}
+
+__attribute__((weak)) int main(int argc, char** argv)
+{
+  unsigned long runMs = 15000;
+  const char* flashPath = nullptr;
+  const char* rtcPath = nullptr;
+  uint32_t reason = REASON_DEFAULT_RST;
+  unsigned long buttonMs = 0;
+  std::vector<const char*> gets;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--soft-restart")) {
+      reason = REASON_SOFT_RESTART;
+    } else if (!strcmp(arg, "--quiet")) {
+      nativeSetSerialOutput(nullptr);
+    } else if (value && !strcmp(arg, "--ms")) {
+      runMs = strtoul(argv[++i], nullptr, 10);
+    } else if (value && !strcmp(arg, "--flash")) {
+      flashPath = argv[++i];
+    } else if (value && !strcmp(arg, "--rtc")) {
+      rtcPath = argv[++i];
+    } else if (value && !strcmp(arg, "--button")) {
+      buttonMs = strtoul(argv[++i], nullptr, 10);
+    } else if (value && !strcmp(arg, "--get")) {
+      gets.push_back(argv[++i]);
+    } else if (value && !strcmp(arg, "--wifi")) {
+      i++;
+      if (!strcmp(value, "connect")) nativeScriptWiFi(NATIVE_WIFI_CONNECT);
+      else if (!strcmp(value, "nossid")) nativeScriptWiFi(NATIVE_WIFI_NO_SSID);
+      else if (!strcmp(value, "wrongpass")) nativeScriptWiFi(NATIVE_WIFI_WRONG_PASSWORD);
+      else if (!strcmp(value, "silent")) nativeScriptWiFi(NATIVE_WIFI_SILENT);
+      else {
+        fprintf(stderr, "unknown WiFi outcome: %s\n", value);
+        return 2;
+      }
+    } else {
+      fprintf(stderr, "usage: %s [--ms N] [--flash FILE] [--rtc FILE] [--soft-restart] [--wifi OUTCOME]... "
+                      "[--button MS] [--get PATH]... [--quiet]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (flashPath) nativeLoadImage(flashPath, nativeFlash(), NATIVE_FLASH_SIZE);
+  nativeBoot(reason);
+  if (rtcPath && reason != REASON_DEFAULT_RST) {
+    nativeLoadImage(rtcPath, nativeRtcMemory(), NATIVE_RTC_USER_MEMORY_SIZE);
+  }
+
+  int status = 0;
+  ESP.resetFreeContStack(); // The sketch's stack starts here, as the cont stack does at boot on the device
+  try {
+    setup();
+    for (const char* path : gets) {
+      runGet(path, runMs);
+    }
+    while (millis() < runMs) {
+      if (buttonMs) {
+        bool held = millis() >= 1000 && millis() < 1000 + buttonMs;
+        nativeSetPin(0, held ? LOW : HIGH);
+      }
+      loop();
+      nativePump();
+    }
+    printf("[native] %lu ms elapsed\n", millis());
+  } catch (const NativeRestart&) {
+    printf("[native] ESP.restart() at %lu ms\n", millis());
+    status = 3;
+  }
+  Serial.flush();
+
+  if (flashPath) nativeSaveImage(flashPath, nativeFlash(), NATIVE_FLASH_SIZE);
+  if (rtcPath) nativeSaveImage(rtcPath, nativeRtcMemory(), NATIVE_RTC_USER_MEMORY_SIZE);
+  const NativeFlashStats& stats = nativeFlashStats();
+  printf("[native] flash: %u reads, %u writes (%u bytes), %u sector erases\n", (unsigned)stats.reads,
+         (unsigned)stats.writes, (unsigned)stats.bytesWritten, (unsigned)stats.erases);
+  return status;
+}
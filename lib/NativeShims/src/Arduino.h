@@ -0,0 +1,100 @@
+// =====================================================================
+// Arduino (native shim)
+// =====================================================================
+// Stand-in for the ESP8266 Arduino core's Arduino.h in the host build (env:native). Provides the subset of
+// the core the sketch, its libraries, ArduinoJson and Bounce2 use; see NativeHost.h for how a host program
+// controls time, pins, WiFi and the emulated flash.
+// - PROGMEM data is ordinary memory, so the *_P functions map to their plain counterparts.
+// - Only built for platform = native (library.json); the ESP8266 environments use the real core.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define ICACHE_FLASH_ATTR
+
+// PROGMEM (pgmspace.h)
+#define PROGMEM
+#define PSTR(s) (s)
+typedef const char* PGM_P;
+typedef const void* PGM_VOID_P;
+class __FlashStringHelper;
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+#define F(s) FPSTR(PSTR(s))
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+#define pgm_read_ptr(addr) (*(const void* const*)(addr))
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define strlen_P strlen
+#define strnlen_P strnlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define strstr_P strstr
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+#if defined(__GLIBC__)
+#if !__GLIBC_PREREQ(2, 38)
+#define NATIVE_NEEDS_STRLCPY
+#endif
+#elif !defined(__APPLE__) && !defined(__FreeBSD__)
+#define NATIVE_NEEDS_STRLCPY
+#endif
+#ifdef NATIVE_NEEDS_STRLCPY
+size_t strlcpy(char* dest, const char* src, size_t size);
+size_t strlcat(char* dest, const char* src, size_t size);
+#endif
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+#include "HardwareSerial.h"
+#include "Esp.h"
+#include "NativeHost.h"
@@ -0,0 +1,55 @@
+// =====================================================================
+// EEPROM (native shim)
+// =====================================================================
+
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+// begin(size_t size)
+// Loads the first size bytes (rounded up to 4, at most one sector) of the EEPROM sector.
+
+void EEPROMClass::begin(size_t size)
+{
+  if (size == 0) return;
+  size = std::min((size + 3) & ~(size_t)3, (size_t)SPI_FLASH_SEC_SIZE);
+  if (_data && size != _size) {
+    free(_data);
+    _data = nullptr;
+  }
+  if (!_data) _data = (uint8_t*)malloc(size);
+  _size = size;
+  ESP.flashRead(NATIVE_EEPROM_ADDR, (uint32_t*)_data, _size);
+  _dirty = false;
+}
+
+uint8_t EEPROMClass::read(int address)
+{
+  return address >= 0 && (size_t)address < _size ? _data[address] : 0;
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+  if (address < 0 || (size_t)address >= _size || _data[address] == value) return;
+  _data[address] = value;
+  _dirty = true;
+}
+
+bool EEPROMClass::commit()
+{
+  if (!_data || !_size) return false;
+  if (!_dirty) return true;
+  if (!ESP.flashEraseSector(NATIVE_EEPROM_ADDR / SPI_FLASH_SEC_SIZE)) return false;
+  if (!ESP.flashWrite(NATIVE_EEPROM_ADDR, (const uint32_t*)_data, _size)) return false;
+  _dirty = false;
+  return true;
+}
+
+bool EEPROMClass::end()
+{
+  bool ok = commit();
+  free(_data);
+  _data = nullptr;
+  _size = 0;
+  return ok;
+}
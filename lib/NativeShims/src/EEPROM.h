@@ -0,0 +1,44 @@
+// =====================================================================
+// EEPROM (native shim)
+// =====================================================================
+// The core's EEPROM emulation: begin() copies the flash sector at NATIVE_EEPROM_ADDR into RAM, commit()
+// erases and rewrites the sector if anything changed, end() commits and frees the copy.
+
+#pragma once
+
+#include "Arduino.h"
+
+class EEPROMClass {
+public:
+  void begin(size_t size);
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+  bool commit();
+  bool end();
+  size_t length() const { return _size; }
+  uint8_t* getDataPtr() { _dirty = true; return _data; }
+  const uint8_t* getConstDataPtr() const { return _data; }
+  uint8_t& operator[](int address) { _dirty = true; return _data[address]; }
+
+  template <typename T> T& get(int address, T& value)
+  {
+    if (address >= 0 && address + sizeof(T) <= _size) memcpy((uint8_t*)&value, _data + address, sizeof(T));
+    return value;
+  }
+
+  template <typename T> const T& put(int address, const T& value)
+  {
+    if (address >= 0 && address + sizeof(T) <= _size && memcmp(_data + address, &value, sizeof(T)) != 0) {
+      memcpy(_data + address, (const uint8_t*)&value, sizeof(T));
+      _dirty = true;
+    }
+    return value;
+  }
+
+private:
+  uint8_t* _data = nullptr;
+  size_t _size = 0;
+  bool _dirty = false;
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,295 @@
+// =====================================================================
+// ESP8266WiFi (native shim)
+// =====================================================================
+// Connection attempts become timed station events; nativePump() delivers those that are due. The station's lwIP
+// interface (lwip/netif.h, lwip/dhcp.h) follows them: it holds a DHCP lease from got-IP to the next disconnect,
+// unless WiFi.config() set a static address.
+
+#include "ESP8266WiFi.h"
+#include "lwip/dhcp.h"
+#include <deque>
+#include <vector>
+
+ESP8266WiFiClass WiFi;
+
+enum WiFiEventType { EVENT_CONNECTED, EVENT_DISCONNECTED, EVENT_GOT_IP };
+
+struct WiFiEventHandlerOpaque {
+  WiFiEventType type;
+  std::function<void(const void*)> callback;
+};
+
+struct PendingEvent {
+  uint64_t at;                        // Virtual time (us)
+  WiFiEventType type;
+  uint8_t reason;
+  unsigned long repeatMs;             // Re-fires every repeatMs until cancelled; 0 fires once
+};
+
+struct ScriptStep {
+  NativeWiFiOutcome outcome;
+  unsigned long delayMs;
+};
+
+static const unsigned long FULL_SCAN_MS = 1800;
+static const unsigned long CACHED_CONNECT_MS = 250;
+static const unsigned long DHCP_MS = 300;
+static const uint8_t DEFAULT_BSSID[6] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC};
+
+static uint32_t dhcpLeaseSeconds = NATIVE_DHCP_LEASE_DEFAULT;
+static struct dhcp stationDhcp;
+static struct netif stationNetif = {nullptr, {0}, &stationDhcp};
+struct netif* netif_list = &stationNetif;
+
+static std::vector<std::weak_ptr<WiFiEventHandlerOpaque>> handlers;
+static std::vector<PendingEvent> pending;
+static std::deque<ScriptStep> script;
+
+// addHandler(WiFiEventType type, std::function<void(const void*)> callback)
+// Registers a handler that stays active while the returned pointer is held.
+
+static WiFiEventHandler addHandler(WiFiEventType type, std::function<void(const void*)> callback)
+{
+  WiFiEventHandler handler = std::make_shared<WiFiEventHandlerOpaque>();
+  handler->type = type;
+  handler->callback = callback;
+  handlers.push_back(handler);
+  return handler;
+}
+
+// fire(WiFiEventType type, const void* event)
+// Calls every live handler of the type; handlers may register or drop handlers while this runs.
+
+static void fire(WiFiEventType type, const void* event)
+{
+  std::vector<WiFiEventHandler> live;
+  for (auto& weak : handlers) {
+    WiFiEventHandler handler = weak.lock();
+    if (handler && handler->type == type) live.push_back(handler);
+  }
+  for (auto& handler : live) {
+    handler->callback(event);
+  }
+}
+
+static void schedule(unsigned long afterMs, WiFiEventType type, uint8_t reason = 0, unsigned long repeatMs = 0)
+{
+  pending.push_back({nativeMicros64() + (uint64_t)afterMs * 1000, type, reason, repeatMs});
+}
+
+uint8_t dhcp_supplied_address(const struct netif* netif)
+{
+  return netif->dhcp && netif->dhcp->bound;
+}
+
+// nativeWiFiSetAddress(bool connected)
+// Updates the station interface after got-IP (connected) or a link loss.
+
+void nativeWiFiSetAddress(bool connected)
+{
+  stationNetif.ip_addr.addr = connected ? (uint32_t)WiFi.localIP() : 0;
+  stationDhcp.bound = connected && !WiFi._staticIp;
+  stationDhcp.offered_t0_lease = stationDhcp.bound ? dhcpLeaseSeconds : 0;
+}
+
+void nativeSetDhcpLease(uint32_t seconds)
+{
+  dhcpLeaseSeconds = seconds;
+}
+
+void nativeScriptWiFi(NativeWiFiOutcome outcome, unsigned long delayMs)
+{
+  script.push_back({outcome, delayMs});
+}
+
+void nativeDropWiFi(uint8_t reason)
+{
+  if (WiFi._status != WL_CONNECTED) return;
+  WiFi._status = WL_DISCONNECTED;
+  nativeWiFiSetAddress(false);
+  pending.clear();
+  schedule(0, EVENT_DISCONNECTED, reason);
+  if (WiFi._autoReconnect) {
+    schedule(FULL_SCAN_MS, EVENT_CONNECTED);
+    schedule(FULL_SCAN_MS + DHCP_MS, EVENT_GOT_IP);
+  }
+}
+
+// nativeWiFiReset()
+// Back to the power-up state for a new boot; scripted outcomes not used yet are kept.
+
+void nativeWiFiReset()
+{
+  WiFi = ESP8266WiFiClass();
+  handlers.clear();
+  pending.clear();
+  nativeWiFiSetAddress(false);
+}
+
+// nativeWiFiPump()
+// Delivers the events that are due, in time order.
+
+void nativeWiFiPump()
+{
+  for (;;) {
+    uint64_t now = nativeMicros64();
+    auto due = pending.end();
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+      if (it->at <= now && (due == pending.end() || it->at < due->at)) due = it;
+    }
+    if (due == pending.end()) return;
+    PendingEvent event = *due;
+    if (event.repeatMs) {
+      due->at += (uint64_t)event.repeatMs * 1000;
+    } else {
+      pending.erase(due);
+    }
+
+    if (event.type == EVENT_CONNECTED) {
+      WiFiEventStationModeConnected info;
+      info.ssid = WiFi._ssid;
+      memcpy(info.bssid, WiFi._bssid, sizeof(info.bssid));
+      info.channel = WiFi._channel;
+      fire(EVENT_CONNECTED, &info);
+    } else if (event.type == EVENT_GOT_IP) {
+      if (!WiFi._staticIp) {
+        WiFi._ip = IPAddress(192, 168, 1, 100);
+        WiFi._gateway = IPAddress(192, 168, 1, 1);
+        WiFi._subnet = IPAddress(255, 255, 255, 0);
+        WiFi._dns = IPAddress(192, 168, 1, 1);
+      }
+      WiFi._status = WL_CONNECTED;
+      nativeWiFiSetAddress(true);
+      WiFiEventStationModeGotIP info;
+      info.ip = WiFi._ip;
+      info.mask = WiFi._subnet;
+      info.gw = WiFi._gateway;
+      fire(EVENT_GOT_IP, &info);
+    } else {
+      WiFi._status = event.reason == WIFI_DISCONNECT_REASON_NO_AP_FOUND ? WL_NO_SSID_AVAIL
+                   : event.reason == WIFI_DISCONNECT_REASON_4WAY_HANDSHAKE_TIMEOUT ? WL_WRONG_PASSWORD
+                   : WL_DISCONNECTED;
+      nativeWiFiSetAddress(false);
+      WiFiEventStationModeDisconnected info;
+      info.ssid = WiFi._ssid;
+      memcpy(info.bssid, WiFi._bssid, sizeof(info.bssid));
+      info.reason = (WiFiDisconnectReason)event.reason;
+      fire(EVENT_DISCONNECTED, &info);
+    }
+  }
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel,
+                                    const uint8_t* bssid, bool connect)
+{
+  (void)passphrase;
+  _ssid = ssid;
+  _mode = (WiFiMode_t)(_mode | WIFI_STA);
+  _status = WL_DISCONNECTED;
+  nativeWiFiSetAddress(false);
+  pending.clear();
+  if (!connect) return _status;
+
+  bool cached = channel > 0 && bssid;
+  memcpy(_bssid, cached ? bssid : DEFAULT_BSSID, sizeof(_bssid));
+  _channel = cached ? channel : 6;
+  ScriptStep step = {NATIVE_WIFI_CONNECT, 0};
+  if (!script.empty()) {
+    step = script.front();
+    script.pop_front();
+  }
+  unsigned long delayMs = step.delayMs ? step.delayMs : cached ? CACHED_CONNECT_MS : FULL_SCAN_MS;
+  switch (step.outcome) {
+    case NATIVE_WIFI_CONNECT:
+      schedule(delayMs, EVENT_CONNECTED);
+      schedule(delayMs + (_staticIp ? 5 : DHCP_MS), EVENT_GOT_IP);
+      break;
+    case NATIVE_WIFI_NO_SSID:
+      schedule(delayMs, EVENT_DISCONNECTED, WIFI_DISCONNECT_REASON_NO_AP_FOUND, std::max(delayMs, 1000UL));
+      break;
+    case NATIVE_WIFI_WRONG_PASSWORD:
+      schedule(delayMs, EVENT_DISCONNECTED, WIFI_DISCONNECT_REASON_4WAY_HANDSHAKE_TIMEOUT, std::max(delayMs, 1000UL));
+      break;
+    case NATIVE_WIFI_SILENT:
+      break;
+  }
+  return _status;
+}
+
+// config(local, gateway, subnet, dns1, dns2)
+// A zero local address switches back to DHCP, as in the core. On a connected station that starts the DHCP client,
+// which binds (got-IP) after DHCP_MS; a static address takes effect at once.
+
+bool ESP8266WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2)
+{
+  (void)dns2;
+  bool wasStatic = _staticIp;
+  _staticIp = local.isSet();
+  if (_staticIp) {
+    _ip = local;
+    _gateway = gateway;
+    _subnet = subnet;
+    _dns = dns1.isSet() ? dns1 : gateway;
+  }
+  if (_status == WL_CONNECTED) {
+    nativeWiFiSetAddress(true);
+    if (wasStatic && !_staticIp) schedule(DHCP_MS, EVENT_GOT_IP);
+  }
+  return true;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifioff)
+{
+  bool wasConnected = _status == WL_CONNECTED;
+  pending.clear();
+  _status = WL_DISCONNECTED;
+  nativeWiFiSetAddress(false);
+  if (wasConnected) {
+    schedule(0, EVENT_DISCONNECTED, WIFI_DISCONNECT_REASON_ASSOC_LEAVE);
+  }
+  if (wifioff) {
+    _mode = (WiFiMode_t)(_mode & ~WIFI_STA);
+  }
+  return true;
+}
+
+bool ESP8266WiFiClass::softAP(const char* ssid, const char* passphrase, int channel, int hidden, int maxConnection)
+{
+  (void)ssid;
+  (void)channel;
+  (void)hidden;
+  (void)maxConnection;
+  if (passphrase && *passphrase && strlen(passphrase) < 8) return false;
+  _mode = (WiFiMode_t)(_mode | WIFI_AP);
+  return true;
+}
+
+bool ESP8266WiFiClass::softAPdisconnect(bool wifioff)
+{
+  (void)wifioff;
+  _mode = (WiFiMode_t)(_mode & ~WIFI_AP);
+  return true;
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeConnected(
+    std::function<void(const WiFiEventStationModeConnected&)> handler)
+{
+  return addHandler(EVENT_CONNECTED, [handler](const void* event) {
+    handler(*(const WiFiEventStationModeConnected*)event);
+  });
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeDisconnected(
+    std::function<void(const WiFiEventStationModeDisconnected&)> handler)
+{
+  return addHandler(EVENT_DISCONNECTED, [handler](const void* event) {
+    handler(*(const WiFiEventStationModeDisconnected*)event);
+  });
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP&)> handler)
+{
+  return addHandler(EVENT_GOT_IP, [handler](const void* event) {
+    handler(*(const WiFiEventStationModeGotIP*)event);
+  });
+}
@@ -0,0 +1,120 @@
+// =====================================================================
+// ESP8266WiFi (native shim)
+// =====================================================================
+// WiFi object of the core with scriptable connect outcomes (nativeScriptWiFi() in NativeHost.h).
+// - Station events are delivered by nativePump(), i.e. from delay()/yield() and between loop() calls.
+// - Handlers stay registered while the returned WiFiEventHandler is held, as in the core.
+// - The station gets 192.168.1.100/24 (gateway .1) by DHCP, or what WiFi.config() set; the AP is 192.168.4.1.
+
+#pragma once
+
+#include "Arduino.h"
+#include <functional>
+#include <memory>
+
+enum wl_status_t {
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_WRONG_PASSWORD = 6,
+  WL_DISCONNECTED = 7
+};
+
+enum WiFiMode_t { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 };
+enum WiFiPhyMode_t { WIFI_PHY_MODE_11B = 1, WIFI_PHY_MODE_11G = 2, WIFI_PHY_MODE_11N = 3 };
+
+enum WiFiDisconnectReason {
+  WIFI_DISCONNECT_REASON_UNSPECIFIED = 1,
+  WIFI_DISCONNECT_REASON_ASSOC_LEAVE = 8,
+  WIFI_DISCONNECT_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+  WIFI_DISCONNECT_REASON_BEACON_TIMEOUT = 200,
+  WIFI_DISCONNECT_REASON_NO_AP_FOUND = 201,
+  WIFI_DISCONNECT_REASON_AUTH_FAIL = 202,
+  WIFI_DISCONNECT_REASON_ASSOC_FAIL = 203,
+  WIFI_DISCONNECT_REASON_HANDSHAKE_TIMEOUT = 204
+};
+
+struct WiFiEventStationModeConnected {
+  String ssid;
+  uint8_t bssid[6];
+  uint8_t channel;
+};
+
+struct WiFiEventStationModeDisconnected {
+  String ssid;
+  uint8_t bssid[6];
+  WiFiDisconnectReason reason;
+};
+
+struct WiFiEventStationModeGotIP {
+  IPAddress ip;
+  IPAddress mask;
+  IPAddress gw;
+};
+
+struct WiFiEventHandlerOpaque;
+typedef std::shared_ptr<WiFiEventHandlerOpaque> WiFiEventHandler;
+
+class ESP8266WiFiClass {
+public:
+  wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                    const uint8_t* bssid = nullptr, bool connect = true);
+  bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(),
+              IPAddress dns2 = IPAddress());
+  bool disconnect(bool wifioff = false);
+  bool isConnected() const { return _status == WL_CONNECTED; }
+  wl_status_t status() const { return _status; }
+  bool setAutoReconnect(bool autoReconnect) { _autoReconnect = autoReconnect; return true; }
+  bool setAutoConnect(bool autoConnect) { (void)autoConnect; return true; }
+  bool persistent(bool persistent) { (void)persistent; return true; }
+
+  IPAddress localIP() const { return _status == WL_CONNECTED ? _ip : IPAddress(); }
+  IPAddress gatewayIP() const { return _status == WL_CONNECTED ? _gateway : IPAddress(); }
+  IPAddress subnetMask() const { return _status == WL_CONNECTED ? _subnet : IPAddress(); }
+  IPAddress dnsIP(uint8_t index = 0) const { (void)index; return _status == WL_CONNECTED ? _dns : IPAddress(); }
+  String SSID() const { return _ssid; }
+  uint8_t* BSSID() { return _bssid; }
+  int32_t channel() const { return _channel; }
+  int32_t RSSI() const { return _status == WL_CONNECTED ? -60 : 31; }
+  String macAddress() const { return String("5C:CF:7F:A1:B2:C3"); }
+  bool setHostname(const char* hostname) { _hostname = hostname; return true; }
+  String hostname() const { return _hostname; }
+
+  bool mode(WiFiMode_t mode) { _mode = mode; return true; }
+  WiFiMode_t getMode() const { return _mode; }
+  bool setPhyMode(WiFiPhyMode_t mode) { (void)mode; return true; }
+  void setOutputPower(float dBm) { (void)dBm; }
+
+  bool softAP(const char* ssid, const char* passphrase = nullptr, int channel = 1, int hidden = 0,
+              int maxConnection = 4);
+  bool softAPdisconnect(bool wifioff = false);
+  IPAddress softAPIP() const { return (_mode & WIFI_AP) ? IPAddress(192, 168, 4, 1) : IPAddress(); }
+  uint8_t softAPgetStationNum() const { return 0; }
+
+  WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected&)> handler);
+  WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected&)> handler);
+  WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP&)> handler);
+
+private:
+  friend void nativeWiFiReset();
+  friend void nativeWiFiPump();
+  friend void nativeDropWiFi(uint8_t reason);
+  friend void nativeWiFiSetAddress(bool connected);
+
+  wl_status_t _status = WL_IDLE_STATUS;
+  WiFiMode_t _mode = WIFI_OFF;
+  bool _autoReconnect = true;
+  bool _staticIp = false;
+  IPAddress _ip, _gateway, _subnet, _dns;
+  String _ssid;
+  String _hostname;
+  uint8_t _bssid[6] = {0};
+  int32_t _channel = 0;
+};
+
+extern ESP8266WiFiClass WiFi;
+
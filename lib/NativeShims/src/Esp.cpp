@@ -0,0 +1,208 @@
+// =====================================================================
+// Esp (native shim)
+// =====================================================================
+
+#include "Arduino.h"
+#include <chrono>
+
+EspClass ESP;
+
+static uint8_t flashImage[NATIVE_FLASH_SIZE];
+static uint8_t rtcMemory[NATIVE_RTC_USER_MEMORY_SIZE];
+static NativeFlashStats flashStats;
+static rst_info resetInfo;
+static bool flashInitialized = false;
+static uint64_t flashSteps = 0;
+static int64_t powerCutStep = -1;          // Value of flashSteps at which the power fails, -1 for never
+
+uint8_t* nativeFlash()
+{
+  if (!flashInitialized) {
+    memset(flashImage, 0xFF, sizeof(flashImage)); // A new chip reads as erased
+    flashInitialized = true;
+  }
+  return flashImage;
+}
+
+uint8_t* nativeRtcMemory()
+{
+  return rtcMemory;
+}
+
+NativeFlashStats& nativeFlashStats()
+{
+  return flashStats;
+}
+
+void nativeCutPowerAt(int64_t steps)
+{
+  powerCutStep = steps < 0 ? -1 : (int64_t)flashSteps + steps;
+}
+
+uint64_t nativeFlashSteps()
+{
+  return flashSteps;
+}
+
+// powerCutDue()
+// Returns true if the power fails in the flash step about to be taken; the scheduled cut is used up then.
+
+static bool powerCutDue()
+{
+  if (powerCutStep < 0 || (int64_t)flashSteps != powerCutStep) return false;
+  powerCutStep = -1;
+  return true;
+}
+
+// nativeResetInfo(uint32_t reason)
+// Sets the reset cause reported by getResetInfoPtr(); called by nativeBoot().
+
+void nativeResetInfo(uint32_t reason)
+{
+  memset(&resetInfo, 0, sizeof(resetInfo));
+  resetInfo.reason = reason;
+  if (reason == REASON_DEFAULT_RST) {
+    for (size_t i = 0; i < sizeof(rtcMemory); i++) {
+      rtcMemory[i] = (uint8_t)(i * 167 + 13); // Power-on garbage
+    }
+  }
+}
+
+void EspClass::restart()
+{
+  Serial.flush();
+  throw NativeRestart();
+}
+
+void EspClass::deepSleep(uint64_t us)
+{
+  nativeAdvanceMicros(us);
+  throw NativeRestart();
+}
+
+uint32_t EspClass::getFlashChipSize() const
+{
+  return NATIVE_FLASH_SIZE;
+}
+
+uint32_t EspClass::getCycleCount() const
+{
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() * 80 / 1000);
+}
+
+// resetFreeContStack() / getFreeContStack()
+// Stack painting on the host stack. The paint starts CONT_STACK_GUARD bytes below the frame of
+// resetFreeContStack(), clear of its own locals; the scan counts painted bytes from the far end. Both work
+// below the stack pointer, which the sanitizers would flag, and are written as plain byte loops so no call
+// of their own lands in the painted range.
+
+static const uint8_t CONT_STACK_PAINT = 0xA5;
+static const size_t CONT_STACK_GUARD = 256;
+static uint8_t* contStackBottom = nullptr; // Lowest painted byte, nullptr before the first reset
+
+__attribute__((noinline, no_sanitize("address", "undefined")))
+void EspClass::resetFreeContStack()
+{
+  uint8_t* top = (uint8_t*)__builtin_frame_address(0) - CONT_STACK_GUARD;
+  volatile uint8_t* bottom = top - NATIVE_CONT_STACK_SIZE;
+  for (volatile uint8_t* p = bottom; p < top; p++) {
+    *p = CONT_STACK_PAINT;
+  }
+  contStackBottom = (uint8_t*)bottom;
+}
+
+__attribute__((noinline, no_sanitize("address", "undefined")))
+uint32_t EspClass::getFreeContStack() const
+{
+  if (!contStackBottom) return NATIVE_CONT_STACK_SIZE;
+  volatile uint8_t* p = contStackBottom;
+  uint32_t free = 0;
+  while (free < NATIVE_CONT_STACK_SIZE && p[free] == CONT_STACK_PAINT) {
+    free++;
+  }
+  return free;
+}
+
+bool EspClass::flashEraseSector(uint32_t sector)
+{
+  if ((uint64_t)(sector + 1) * SPI_FLASH_SEC_SIZE > NATIVE_FLASH_SIZE) return false;
+  uint8_t* target = nativeFlash() + sector * SPI_FLASH_SEC_SIZE;
+  if (powerCutDue()) {
+    for (size_t i = 0; i < SPI_FLASH_SEC_SIZE; i++) {
+      target[i] = (uint8_t)((i * 151 + sector * 29) ^ 0x5A); // Half-erased cells read as noise
+    }
+    throw NativePowerLoss();
+  }
+  memset(target, 0xFF, SPI_FLASH_SEC_SIZE);
+  flashStats.erases++;
+  flashSteps++;
+  return true;
+}
+
+bool EspClass::flashWrite(uint32_t address, const uint8_t* data, size_t size)
+{
+  if ((uint64_t)address + size > NATIVE_FLASH_SIZE) return false;
+  uint8_t* target = nativeFlash() + address;
+  for (size_t i = 0; i < size; i++) {
+    if (powerCutDue()) {
+      flashStats.writes++;
+      flashStats.bytesWritten += i;
+      throw NativePowerLoss();
+    }
+    target[i] &= data[i]; // NOR flash: programming only clears bits
+    flashSteps++;
+  }
+  flashStats.writes++;
+  flashStats.bytesWritten += size;
+  return true;
+}
+
+bool EspClass::flashWrite(uint32_t address, const uint32_t* data, size_t size)
+{
+  if ((address | size) & 3) return false;
+  return flashWrite(address, (const uint8_t*)data, size);
+}
+
+bool EspClass::flashRead(uint32_t address, uint8_t* data, size_t size)
+{
+  if ((uint64_t)address + size > NATIVE_FLASH_SIZE) return false;
+  memcpy(data, nativeFlash() + address, size);
+  flashStats.reads++;
+  flashStats.bytesRead += size;
+  return true;
+}
+
+bool EspClass::flashRead(uint32_t address, uint32_t* data, size_t size)
+{
+  if ((address | size) & 3) return false;
+  return flashRead(address, (uint8_t*)data, size);
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size)
+{
+  if (offset * 4 + size > sizeof(rtcMemory) || (size & 3)) return false;
+  memcpy(data, rtcMemory + offset * 4, size);
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size)
+{
+  if (offset * 4 + size > sizeof(rtcMemory) || (size & 3)) return false;
+  memcpy(rtcMemory + offset * 4, data, size);
+  return true;
+}
+
+rst_info* EspClass::getResetInfoPtr()
+{
+  return &resetInfo;
+}
+
+String EspClass::getResetReason()
+{
+  static const char* const names[] = {
+    "Power On", "Hardware Watchdog", "Exception", "Software Watchdog", "Software/System restart",
+    "Deep-Sleep Wake", "External System"
+  };
+  return String(resetInfo.reason < 7 ? names[resetInfo.reason] : "Unknown");
+}
@@ -0,0 +1,57 @@
+// =====================================================================
+// Esp (native shim)
+// =====================================================================
+// The ESP object of the core, backed by host memory:
+// - Flash is a NATIVE_FLASH_SIZE image with NOR semantics: erase sets a sector to 0xFF, writes can only clear
+//   bits. The uint32_t* flashRead()/flashWrite() forms need 4-byte aligned addresses and sizes, like SPIRead().
+//   Writes and erases can be interrupted by a simulated power cut (nativeCutPowerAt() in NativeHost.h).
+// - RTC user memory is 512 bytes; it survives a simulated soft restart (see NativeHost.h) and holds garbage
+//   after a power-on.
+// - restart() throws NativeRestart: the current boot ends there.
+// - getCycleCount() counts host time at the ESP8266's 80 MHz; heap figures are fixed values.
+// - The sketch runs on the host stack, so resetFreeContStack() paints NATIVE_CONT_STACK_SIZE bytes below the
+//   caller's frame and getFreeContStack() returns how many of them are still painted, as the core does for its
+//   cont stack. Until the first reset it returns NATIVE_CONT_STACK_SIZE. Host frames are larger than Xtensa
+//   ones, so compare the figures with host bounds, not with the device's 4 KB.
+
+#pragma once
+
+#include "WString.h"
+#include <stdint.h>
+#include <stddef.h>
+#include "user_interface.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+class EspClass {
+public:
+  [[noreturn]] void restart();
+  [[noreturn]] void reset() { restart(); }
+  void deepSleep(uint64_t us);
+
+  uint32_t getChipId() const { return 0x00A1B2C3; }
+  uint32_t getFlashChipSize() const;
+  uint32_t getFlashChipRealSize() const { return getFlashChipSize(); }
+  uint32_t getCpuFreqMHz() const { return 80; }
+  uint32_t getCycleCount() const;
+
+  uint32_t getFreeHeap() const { return 40000; }
+  uint32_t getMaxFreeBlockSize() const { return 36000; }
+  uint8_t getHeapFragmentation() const { return 0; }
+  uint32_t getFreeContStack() const;
+  void resetFreeContStack();
+
+  bool flashEraseSector(uint32_t sector);
+  bool flashWrite(uint32_t address, const uint32_t* data, size_t size);
+  bool flashWrite(uint32_t address, const uint8_t* data, size_t size);
+  bool flashRead(uint32_t address, uint32_t* data, size_t size);
+  bool flashRead(uint32_t address, uint8_t* data, size_t size);
+
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+
+  rst_info* getResetInfoPtr();
+  String getResetReason();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,25 @@
+// =====================================================================
+// HardwareSerial (native shim)
+// =====================================================================
+// Serial output goes to the FILE set with nativeSetSerialOutput() (stdout by default, nullptr mutes it).
+// There is no serial input.
+
+#pragma once
+
+#include "Stream.h"
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  void flush() override;
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,39 @@
+// =====================================================================
+// IPAddress (native shim)
+// =====================================================================
+
+#include "Arduino.h"
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+// fromString(const char* text)
+// Parses a dotted quad ("192.168.1.10"); leaves the address unchanged and returns false otherwise.
+
+bool IPAddress::fromString(const char* text)
+{
+  uint8_t parsed[4];
+  int part = 0;
+  int value = -1;
+  for (const char* p = text; ; p++) {
+    if (*p >= '0' && *p <= '9') {
+      value = (value < 0 ? 0 : value * 10) + (*p - '0');
+      if (value > 255) return false;
+    } else if ((*p == '.' || *p == '\0') && value >= 0 && part < 4) {
+      parsed[part++] = (uint8_t)value;
+      value = -1;
+      if (*p == '\0') break;
+    } else {
+      return false;
+    }
+  }
+  if (part != 4) return false;
+  memcpy(_address, parsed, sizeof(_address));
+  return true;
+}
+
+String IPAddress::toString() const
+{
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+  return String(buffer);
+}
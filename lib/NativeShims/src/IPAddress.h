@@ -0,0 +1,34 @@
+// =====================================================================
+// IPAddress (native shim)
+// =====================================================================
+// IPv4 address with the core's accessors; the uint32_t form is in network byte order, as on the ESP8266.
+
+#pragma once
+
+#include "Print.h"
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : _address{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address{a, b, c, d} {}
+  IPAddress(uint32_t address) { memcpy(_address, &address, sizeof(_address)); }
+  IPAddress(const uint8_t* address) { memcpy(_address, address, sizeof(_address)); }
+
+  bool fromString(const char* text);
+  bool fromString(const String& text) { return fromString(text.c_str()); }
+  String toString() const;
+  bool isSet() const { return (uint32_t)*this != 0; }
+
+  operator uint32_t() const { uint32_t v; memcpy(&v, _address, sizeof(v)); return v; }
+  bool operator==(const IPAddress& other) const { return (uint32_t)*this == (uint32_t)other; }
+  bool operator!=(const IPAddress& other) const { return !(*this == other); }
+  uint8_t operator[](int index) const { return _address[index]; }
+  uint8_t& operator[](int index) { return _address[index]; }
+
+  size_t printTo(Print& out) const override { return out.print(toString()); }
+
+private:
+  uint8_t _address[4];
+};
+
+extern const IPAddress INADDR_NONE;
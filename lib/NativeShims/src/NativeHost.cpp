@@ -0,0 +1,169 @@
+// =====================================================================
+// NativeHost
+// =====================================================================
+// Virtual clock, GPIO levels, Serial output and the event pump of the host build.
+
+#include "Arduino.h"
+
+void nativeResetInfo(uint32_t reason);  // Esp.cpp
+void nativeWiFiReset();                 // ESP8266WiFi.cpp
+void nativeWiFiPump();
+
+HardwareSerial Serial;
+
+static uint64_t nowMicros = 0;
+static std::function<void()> yieldHook;
+static bool pumping = false;
+static FILE* serialOutput = stdout;
+static int pinLevels[17] = {HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+                            HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH};
+static uint32_t randomState = 1;
+
+void nativeBoot(uint32_t reason)
+{
+  nowMicros = 0;
+  nativeResetInfo(reason);
+  nativeWiFiReset();
+}
+
+void nativeAdvanceMicros(uint64_t us)
+{
+  nowMicros += us;
+}
+
+void nativeAdvance(unsigned long ms)
+{
+  nowMicros += (uint64_t)ms * 1000;
+}
+
+uint64_t nativeMicros64()
+{
+  return nowMicros;
+}
+
+// nativePump()
+// Runs what the SDK would run between sketch code: due WiFi events, then the host's yield hook.
+// Not re-entered when the hook itself yields.
+
+void nativePump()
+{
+  if (pumping) return;
+  pumping = true;
+  nativeWiFiPump();
+  if (yieldHook) yieldHook();
+  pumping = false;
+}
+
+void nativeSetYieldHook(std::function<void()> hook)
+{
+  yieldHook = hook;
+}
+
+void nativeSetPin(uint8_t pin, int level)
+{
+  if (pin < sizeof(pinLevels) / sizeof(pinLevels[0])) pinLevels[pin] = level;
+}
+
+void nativeSetSerialOutput(FILE* out)
+{
+  serialOutput = out;
+}
+
+bool nativeLoadImage(const char* path, uint8_t* data, size_t size)
+{
+  FILE* file = fopen(path, "rb");
+  if (!file) return false;
+  bool ok = fread(data, 1, size, file) == size;
+  fclose(file);
+  return ok;
+}
+
+bool nativeSaveImage(const char* path, const uint8_t* data, size_t size)
+{
+  FILE* file = fopen(path, "wb");
+  if (!file) return false;
+  bool ok = fwrite(data, 1, size, file) == size;
+  return fclose(file) == 0 && ok;
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(nowMicros / 1000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)nowMicros;
+}
+
+void delay(unsigned long ms)
+{
+  nowMicros += (uint64_t)ms * 1000;
+  nativePump();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  nowMicros += us;
+}
+
+void yield()
+{
+  nowMicros += NATIVE_YIELD_TICK_US;
+  nativePump();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin < sizeof(pinLevels) / sizeof(pinLevels[0]) ? pinLevels[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  (void)pin;
+  (void)value;
+}
+
+// random(long max)
+// Deterministic pseudo-random numbers (same sequence every run unless randomSeed() is called), so host
+// runs are reproducible.
+
+long random(long max)
+{
+  if (max <= 0) return 0;
+  randomState = randomState * 1103515245 + 12345;
+  return (long)((randomState >> 1) % (unsigned long)max);
+}
+
+long random(long min, long max)
+{
+  return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed)
+{
+  randomState = seed ? (uint32_t)seed : 1;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  if (serialOutput) fputc(c, serialOutput);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+  if (serialOutput) fwrite(buffer, 1, size, serialOutput);
+  return size;
+}
+
+void HardwareSerial::flush()
+{
+  if (serialOutput) fflush(serialOutput);
+}
@@ -0,0 +1,92 @@
+// =====================================================================
+// NativeHost
+// =====================================================================
+// Control surface of the host build (env:native). The shims in lib/NativeShims stand in for the ESP8266 core;
+// host programs (the default main() of lib/NativeMain, tools, benchmarks) use these functions to drive them.
+// - Time is virtual: millis()/micros() start at 0 on each nativeBoot() and only move in delay(), yield()
+//   (NATIVE_YIELD_TICK_US per call, so loops that wait on millis() end) and nativeAdvance().
+// - nativePump() delivers due WiFi events and then runs the yield hook; delay() and yield() call it, as the
+//   SDK runs between loop() iterations and inside yield() on the device.
+// - Flash (journal and EEPROM sector) and RTC user memory are plain arrays that outlive a boot, so one process
+//   can simulate restarts; nativeLoadImage()/nativeSaveImage() carry them between runs. nativeCutPowerAt()
+//   interrupts a flash operation at a chosen byte or erase, for power-loss tests.
+// - Globals of the sketch are not reset by nativeBoot(): run one boot per process to start from a clean state.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <functional>
+
+#define NATIVE_FLASH_SIZE 0x80000u          // 512 KB, the esp01 layout (eagle.flash.512k64.ld)
+#define NATIVE_EEPROM_ADDR 0x7B000u         // EEPROM sector, right after the filesystem region
+#define NATIVE_RTC_USER_MEMORY_SIZE 512
+#define NATIVE_YIELD_TICK_US 100
+#define NATIVE_CONT_STACK_SIZE 65536u       // Host stack painted by ESP.resetFreeContStack()
+
+// Thrown by ESP.restart(); the boot that called it is over.
+struct NativeRestart {};
+
+// Thrown by the flash write or erase that a power cut scheduled with nativeCutPowerAt() interrupts.
+struct NativePowerLoss {};
+
+// Starts a boot with the given reset reason: time restarts at 0 and the WiFi shim is reset. A power-on
+// (REASON_DEFAULT_RST) also fills RTC user memory with garbage, as on the device.
+void nativeBoot(uint32_t reason);
+
+void nativeAdvance(unsigned long ms);
+void nativeAdvanceMicros(uint64_t us);
+uint64_t nativeMicros64();
+void nativePump();
+void nativeSetYieldHook(std::function<void()> hook);
+
+// GPIO levels seen by digitalRead(); inputs idle HIGH (pull-up).
+void nativeSetPin(uint8_t pin, int level);
+
+// Serial output goes to out (stdout by default); nullptr discards it.
+void nativeSetSerialOutput(FILE* out);
+
+uint8_t* nativeFlash();                     // NATIVE_FLASH_SIZE bytes
+uint8_t* nativeRtcMemory();                 // NATIVE_RTC_USER_MEMORY_SIZE bytes
+bool nativeLoadImage(const char* path, uint8_t* data, size_t size);
+bool nativeSaveImage(const char* path, const uint8_t* data, size_t size);
+
+// Flash operations since the last reset of the counters.
+struct NativeFlashStats {
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t erases;
+  uint32_t bytesRead;
+  uint32_t bytesWritten;
+};
+NativeFlashStats& nativeFlashStats();
+
+// Power-loss injection. Flash work is counted in steps: each programmed byte and each sector erase is one step.
+// nativeCutPowerAt(n) lets n more steps complete and cuts the power in the next one, which throws NativePowerLoss:
+// - A write keeps the bytes programmed before the cut; the rest of it is not written.
+// - An erase leaves the sector holding garbage, as NOR flash content is undefined in the middle of an erase.
+// nativeCutPowerAt(-1) cancels it (the default). nativeFlashSteps() counts all steps since the program started.
+void nativeCutPowerAt(int64_t steps);
+uint64_t nativeFlashSteps();
+
+// What the next WiFi.begin() leads to, after delayMs (0: typical timing, shorter with a cached BSSID/channel).
+// Outcomes are used in the order scripted; once used up, every attempt connects.
+// - NATIVE_WIFI_CONNECT: Associates, then gets an IP (by DHCP unless WiFi.config() set a static one).
+// - NATIVE_WIFI_NO_SSID / NATIVE_WIFI_WRONG_PASSWORD: Disconnect events (reason 201 / 15), repeated until the
+//   next begin() or disconnect(), like the SDK's retries.
+// - NATIVE_WIFI_SILENT: No event at all.
+enum NativeWiFiOutcome {
+  NATIVE_WIFI_CONNECT,
+  NATIVE_WIFI_NO_SSID,
+  NATIVE_WIFI_WRONG_PASSWORD,
+  NATIVE_WIFI_SILENT
+};
+void nativeScriptWiFi(NativeWiFiOutcome outcome, unsigned long delayMs = 0);
+
+// Drops an established station link with a disconnect event (200: beacon timeout).
+void nativeDropWiFi(uint8_t reason = 200);
+
+// Lease time (seconds) the simulated DHCP server grants from the next bind on (lwip/dhcp.h offered_t0_lease).
+#define NATIVE_DHCP_LEASE_DEFAULT 3600
+void nativeSetDhcpLease(uint32_t seconds);
@@ -0,0 +1,73 @@
+// =====================================================================
+// Print (native shim)
+// =====================================================================
+
+#include "Arduino.h"
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+  size_t written = 0;
+  while (size--) {
+    if (!write(*buffer++)) break;
+    written++;
+  }
+  return written;
+}
+
+// vprint(Print& out, const char* format, va_list args)
+// Formats into a stack buffer, or a heap buffer for long output, and writes the result.
+
+static size_t vprint(Print& out, const char* format, va_list args)
+{
+  char buffer[128];
+  va_list copy;
+  va_copy(copy, args);
+  int length = vsnprintf(buffer, sizeof(buffer), format, copy);
+  va_end(copy);
+  if (length < 0) return 0;
+  if ((size_t)length < sizeof(buffer)) return out.write(buffer, length);
+  char* large = (char*)malloc(length + 1);
+  if (!large) return 0;
+  vsnprintf(large, length + 1, format, args);
+  size_t written = out.write(large, length);
+  free(large);
+  return written;
+}
+
+size_t Print::printf(const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  size_t written = vprint(*this, format, args);
+  va_end(args);
+  return written;
+}
+
+size_t Print::printf_P(PGM_P format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  size_t written = vprint(*this, format, args);
+  va_end(args);
+  return written;
+}
+
+size_t Print::print(long long value, int base)
+{
+  if (base == DEC) return printf("%lld", value);
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(unsigned long long value, int base)
+{
+  if (base < 2 || base > 36) base = DEC;
+  char buffer[8 * sizeof(value) + 1];
+  char* p = buffer + sizeof(buffer);
+  *--p = '\0';
+  do {
+    unsigned digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  return write(p);
+}
@@ -0,0 +1,53 @@
+// =====================================================================
+// Print (native shim)
+// =====================================================================
+// Arduino Print and Printable: subclasses implement write(uint8_t) (and optionally the buffer version);
+// print(), println() and printf() format on top of it like the core does.
+
+#pragma once
+
+#include "WString.h"
+#include <stdint.h>
+#include <stddef.h>
+
+class Print;
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& out) const = 0;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t printf_P(PGM_P format, ...) __attribute__((format(printf, 2, 3)));
+
+  size_t print(const __FlashStringHelper* text) { return write(reinterpret_cast<const char*>(text)); }
+  size_t print(const String& text) { return write(text.c_str(), text.length()); }
+  size_t print(const char* text) { return write(text); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+  size_t print(unsigned long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+  size_t print(long long value, int base = DEC);
+  size_t print(unsigned long long value, int base = DEC);
+  size_t print(double value, int digits = 2) { return print(String(value, (unsigned char)digits)); }
+  size_t print(const Printable& value) { return value.printTo(*this); }
+
+  template <typename T> size_t println(const T& value) { return print(value) + println(); }
+  template <typename T> size_t println(const T& value, int format) { return print(value, format) + println(); }
+  size_t println(const char* text) { return print(text) + println(); }
+  size_t println(const __FlashStringHelper* text) { return print(text) + println(); }
+  size_t println() { return write("\r\n"); }
+};
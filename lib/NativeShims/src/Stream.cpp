@@ -0,0 +1,61 @@
+// =====================================================================
+// Stream (native shim)
+// =====================================================================
+
+#include "Arduino.h"
+
+// timedRead()
+// Returns the next byte, waiting up to the timeout for one; -1 on timeout.
+
+int Stream::timedRead()
+{
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    yield();
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator) break;
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+String Stream::readString()
+{
+  String result;
+  int c;
+  while ((c = timedRead()) >= 0) {
+    result += (char)c;
+  }
+  return result;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+  String result;
+  int c;
+  while ((c = timedRead()) >= 0 && c != terminator) {
+    result += (char)c;
+  }
+  return result;
+}
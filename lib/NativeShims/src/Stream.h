@@ -0,0 +1,29 @@
+// =====================================================================
+// Stream (native shim)
+// =====================================================================
+// Arduino Stream: the timed reads wait (yielding, so virtual time advances) up to setTimeout() for data.
+
+#pragma once
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  virtual size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  size_t readBytesUntil(char terminator, char* buffer, size_t length);
+  String readString();
+  String readStringUntil(char terminator);
+
+protected:
+  int timedRead();
+
+  unsigned long _timeout = 1000;
+};
@@ -0,0 +1,173 @@
+// =====================================================================
+// WString (native shim)
+// =====================================================================
+
+#include "Arduino.h"
+
+// formatInteger(unsigned long value, unsigned char base, bool negative)
+// Renders value in base 2..36 like the core's ultoa(), with a leading '-' if negative.
+
+static std::string formatInteger(unsigned long value, unsigned char base, bool negative)
+{
+  if (base < 2 || base > 36) base = 10;
+  char buffer[8 * sizeof(long) + 2];
+  char* p = buffer + sizeof(buffer);
+  *--p = '\0';
+  do {
+    unsigned digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  if (negative) *--p = '-';
+  return p;
+}
+
+String::String(unsigned char value, unsigned char base) : _text(formatInteger(value, base, false)) {}
+String::String(unsigned int value, unsigned char base) : _text(formatInteger(value, base, false)) {}
+String::String(unsigned long value, unsigned char base) : _text(formatInteger(value, base, false)) {}
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+
+String::String(long value, unsigned char base)
+  : _text(base == 10 && value < 0 ? formatInteger(0UL - (unsigned long)value, 10, true)
+                                  : formatInteger((unsigned long)value, base, false))
+{
+}
+
+String::String(double value, unsigned char decimals)
+{
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  _text = buffer;
+}
+
+bool String::endsWith(const String& suffix) const
+{
+  return suffix.length() <= length() &&
+         _text.compare(length() - suffix.length(), suffix.length(), suffix._text) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const
+{
+  size_t found = _text.find(c, from);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::indexOf(const String& text, unsigned int from) const
+{
+  size_t found = _text.find(text._text, from);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::lastIndexOf(char c) const
+{
+  size_t found = _text.rfind(c);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+  if (from > to) std::swap(from, to);
+  if (from >= length()) return String();
+  if (to > length()) to = length();
+  return String(_text.substr(from, to - from));
+}
+
+void String::replace(const String& find, const String& replacement)
+{
+  if (find.isEmpty()) return;
+  size_t pos = 0;
+  while ((pos = _text.find(find._text, pos)) != std::string::npos) {
+    _text.replace(pos, find.length(), replacement._text);
+    pos += replacement.length();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+  if (index < length()) _text.erase(index, count);
+}
+
+void String::toLowerCase()
+{
+  for (char& c : _text) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+  for (char& c : _text) c = toupper((unsigned char)c);
+}
+
+void String::trim()
+{
+  size_t first = 0;
+  while (first < _text.size() && isspace((unsigned char)_text[first])) first++;
+  size_t last = _text.size();
+  while (last > first && isspace((unsigned char)_text[last - 1])) last--;
+  _text = _text.substr(first, last - first);
+}
+
+void String::toCharArray(char* buffer, unsigned int size, unsigned int index) const
+{
+  getBytes((unsigned char*)buffer, size, index);
+}
+
+void String::getBytes(unsigned char* buffer, unsigned int size, unsigned int index) const
+{
+  if (!size || !buffer) return;
+  if (index >= length()) {
+    buffer[0] = 0;
+    return;
+  }
+  size_t count = std::min((size_t)size - 1, _text.size() - index);
+  memcpy(buffer, _text.data() + index, count);
+  buffer[count] = 0;
+}
+
+String operator+(const String& left, const String& right)
+{
+  String result(left);
+  result.concat(right);
+  return result;
+}
+
+String operator+(const String& left, const char* right)
+{
+  String result(left);
+  result.concat(right);
+  return result;
+}
+
+String operator+(const char* left, const String& right)
+{
+  String result(left);
+  result.concat(right);
+  return result;
+}
+
+String operator+(const String& left, char right)
+{
+  String result(left);
+  result.concat(right);
+  return result;
+}
+
+#ifdef NATIVE_NEEDS_STRLCPY
+size_t strlcpy(char* dest, const char* src, size_t size)
+{
+  size_t length = strlen(src);
+  if (size) {
+    size_t count = length < size - 1 ? length : size - 1;
+    memcpy(dest, src, count);
+    dest[count] = '\0';
+  }
+  return length;
+}
+
+size_t strlcat(char* dest, const char* src, size_t size)
+{
+  size_t used = strnlen(dest, size);
+  if (used == size) return size + strlen(src);
+  return used + strlcpy(dest + used, src, size - used);
+}
+#endif
@@ -0,0 +1,89 @@
+// =====================================================================
+// WString (native shim)
+// =====================================================================
+// Arduino String on top of std::string, with the core's method names and semantics (indexOf() returns -1,
+// substring() clamps, toInt() returns 0 for non-numbers).
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+class __FlashStringHelper;
+
+class String {
+public:
+  String() {}
+  String(const char* text) : _text(text ? text : "") {}
+  String(const char* text, size_t length) : _text(text, length) {}
+  String(const __FlashStringHelper* text) : String(reinterpret_cast<const char*>(text)) {}
+  String(const std::string& text) : _text(text) {}
+  explicit String(char c) : _text(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(double value, unsigned char decimals = 2);
+
+  const char* c_str() const { return _text.c_str(); }
+  unsigned int length() const { return _text.size(); }
+  bool isEmpty() const { return _text.empty(); }
+  bool reserve(unsigned int size) { _text.reserve(size); return true; }
+  char charAt(unsigned int index) const { return index < _text.size() ? _text[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index) { return _text[index]; }
+  const char* begin() const { return _text.c_str(); }
+  const char* end() const { return _text.c_str() + _text.size(); }
+
+  bool concat(const String& other) { _text += other._text; return true; }
+  bool concat(const char* text) { if (text) _text += text; return true; }
+  bool concat(const char* text, unsigned int length) { if (text) _text.append(text, length); return true; }
+  bool concat(char c) { _text += c; return true; }
+  bool concat(int value) { return concat(String(value)); }
+  bool concat(unsigned int value) { return concat(String(value)); }
+  bool concat(long value) { return concat(String(value)); }
+  bool concat(unsigned long value) { return concat(String(value)); }
+  template <typename T> String& operator+=(const T& value) { concat(value); return *this; }
+
+  bool equals(const String& other) const { return _text == other._text; }
+  bool equals(const char* text) const { return _text == (text ? text : ""); }
+  bool equalsIgnoreCase(const String& other) const { return strcasecmp(c_str(), other.c_str()) == 0; }
+  bool operator==(const String& other) const { return equals(other); }
+  bool operator==(const char* text) const { return equals(text); }
+  bool operator!=(const String& other) const { return !equals(other); }
+  bool operator!=(const char* text) const { return !equals(text); }
+  bool operator<(const String& other) const { return _text < other._text; }
+  int compareTo(const String& other) const { return _text.compare(other._text); }
+  bool startsWith(const String& prefix) const { return _text.compare(0, prefix.length(), prefix._text) == 0; }
+  bool endsWith(const String& suffix) const;
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String& text, unsigned int from = 0) const;
+  int lastIndexOf(char c) const;
+  String substring(unsigned int from) const { return substring(from, length()); }
+  String substring(unsigned int from, unsigned int to) const;
+
+  void replace(const String& find, const String& replacement);
+  void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+  long toInt() const { return atol(c_str()); }
+  float toFloat() const { return (float)atof(c_str()); }
+  double toDouble() const { return atof(c_str()); }
+  void toCharArray(char* buffer, unsigned int size, unsigned int index = 0) const;
+  void getBytes(unsigned char* buffer, unsigned int size, unsigned int index = 0) const;
+
+  const std::string& str() const { return _text; }
+
+private:
+  std::string _text;
+};
+
+String operator+(const String& left, const String& right);
+String operator+(const String& left, const char* right);
+String operator+(const char* left, const String& right);
+String operator+(const String& left, char right);
@@ -0,0 +1,14 @@
+// =====================================================================
+// flash_hal (native shim)
+// =====================================================================
+// Filesystem region of the esp01 environment's layout (eagle.flash.512k64.ld): 64 KB ending where the
+// EEPROM sector starts, in the NATIVE_FLASH_SIZE image of Esp.h.
+
+#pragma once
+
+#include "Arduino.h"
+
+#define FS_PHYS_ADDR 0x6B000u
+#define FS_PHYS_SIZE 0x10000u
+#define FS_PHYS_PAGE 0x100u
+#define FS_PHYS_BLOCK 0x1000u
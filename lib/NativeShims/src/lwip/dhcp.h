@@ -0,0 +1,18 @@
+// =====================================================================
+// lwip/dhcp (native shim)
+// =====================================================================
+// lwIP's DHCP client state as far as the sketch reads it: whether the interface address came from a DHCP server
+// and the lease time it granted (nativeSetDhcpLease() in NativeHost.h).
+
+#pragma once
+
+#include "netif.h"
+
+struct dhcp {
+  uint8_t bound;                 // Shim only; lwIP keeps a state machine (dhcp_supplied_address() reads it)
+  uint32_t offered_t0_lease;     // Lease time in seconds
+};
+
+#define netif_dhcp_data(netif) ((netif)->dhcp)
+
+uint8_t dhcp_supplied_address(const struct netif* netif);
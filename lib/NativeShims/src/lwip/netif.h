@@ -0,0 +1,26 @@
+// =====================================================================
+// lwip/netif (native shim)
+// =====================================================================
+// The part of lwIP's network interface list the sketch reads: the station interface (the only one in the list)
+// with its IPv4 address and DHCP client, kept up to date by the WiFi shim.
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t addr;
+} ip4_addr_t;
+
+struct dhcp;
+
+struct netif {
+  struct netif* next;
+  ip4_addr_t ip_addr;
+  struct dhcp* dhcp;
+};
+
+extern struct netif* netif_list;
+
+#define netif_ip4_addr(netif) ((const ip4_addr_t*)&((netif)->ip_addr))
+#define ip4_addr_get_u32(src) ((src)->addr)
@@ -0,0 +1,28 @@
+// =====================================================================
+// user_interface (native shim)
+// =====================================================================
+// The reset cause of the SDK's user_interface.h; set it for a boot with nativeBoot().
+
+#pragma once
+
+#include <stdint.h>
+
+enum rst_reason {
+  REASON_DEFAULT_RST = 0,   // Power on
+  REASON_WDT_RST = 1,
+  REASON_EXCEPTION_RST = 2,
+  REASON_SOFT_WDT_RST = 3,
+  REASON_SOFT_RESTART = 4,  // ESP.restart()
+  REASON_DEEP_SLEEP_AWAKE = 5,
+  REASON_EXT_SYS_RST = 6    // Reset pin
+};
+
+struct rst_info {
+  uint32_t reason;
+  uint32_t exccause;
+  uint32_t epc1;
+  uint32_t epc2;
+  uint32_t epc3;
+  uint32_t excvaddr;
+  uint32_t depc;
+};
@@ -8,6 +8,7 @@
 // 
 // Key Features:
 // - Web server for configuration (network settings, JSON editor, restart, factory reset).
+// - JSON REST API at /api/config (GET, PUT, PATCH as RFC 7396 merge patch, If-Match) for provisioning scripts.
 // - EEPROM storage for persistent configuration.
 // - Button handling for mode toggling and factory reset.
 // - JSON-based configuration for easy extension.
@@ -35,17 +36,39 @@
 // 
 // Warnings:
 // - EEPROM size is set to 2048 bytes; adjust if needed but ensure it fits your config.
-// - Web server uses port 80; ensure no conflicts.
+// - The config is stored in the last four sectors of the filesystem region; do not use them from LittleFS,
+//   and pick a flash layout with a filesystem (see platformio.ini).
+// - Web server uses port 80; ensure no conflicts. It is AsyncHttpServer (lib/AsyncHttpServer), which serves
+//   several clients at once; build with -DWEB_SERVER_LEGACY to use the core's ESP8266WebServer instead.
 // - Security: AP password is hardcoded; change for production.
 // - Libraries: Ensure all included libraries are installed in Arduino IDE.
+// - Host build: "pio run -e native" compiles this sketch for Linux against the shims in lib/NativeShims
+//   (virtual time, emulated flash, scriptable WiFi, web server over a loopback); see NativeHost.h.
+// - Build with -DCONFIG_BENCH (env:esp01_bench, env:native) for /bench, which times loading, parsing and saving
+//   configs from the default size up to 2 KB; it writes flash on every run.
+// - Web assets (web/) are embedded into include/web_assets.h at build time by tools/gzip_assets.py;
+//   PlatformIO runs it automatically, elsewhere run it by hand before compiling.
 
 #include <ESP8266WiFi.h>
 #include <ArduinoJson.h>
 #include <Adafruit_NeoPixel.h>
+#ifdef WEB_SERVER_LEGACY
 #include <ESP8266WebServer.h>
+#else
+#include <AsyncHttpServer.h>
+#endif
+#include <JsonPoolAllocator.h>
+#include <JsonFieldScanner.h>
 #include <EEPROM.h>
+#include <flash_hal.h>
+extern "C" {
+#include <user_interface.h>
+}
+#include <lwip/dhcp.h>
+#include <lwip/netif.h>
 #include <time.h>
 #include <Bounce2.h>
+#include "web_assets.h"
 
 // =====================================================================
 // Enum Definitions
@@ -60,6 +83,23 @@ enum DeviceState {
   STATE_RUN
 };
 
+// This enum defines the states of the STA connection, stepped by updateWiFi() from loop():
+// - WIFI_STATE_IDLE: No STA connection attempted (CONFIG mode).
+// - WIFI_STATE_CONNECTING: WiFi.begin() issued, using the cached BSSID/channel if there is one.
+// - WIFI_STATE_RETRYING: The cached attempt failed; connecting again with a full scan.
+// - WIFI_STATE_CONNECTED: The station has an IP address.
+// - WIFI_STATE_RECONNECTING: The link was lost in RUN mode; reconnecting with jittered exponential backoff.
+// - WIFI_STATE_FAILED_AP: No connection within the timeout; the device fell back to AP mode.
+
+enum WifiState {
+  WIFI_STATE_IDLE,
+  WIFI_STATE_CONNECTING,
+  WIFI_STATE_RETRYING,
+  WIFI_STATE_CONNECTED,
+  WIFI_STATE_RECONNECTING,
+  WIFI_STATE_FAILED_AP
+};
+
 // =====================================================================
 // Forward Declarations
 // =====================================================================
@@ -67,55 +107,288 @@ enum DeviceState {
 // They are necessary to avoid compilation errors due to functions being called before their definitions.
 // Each function's purpose is detailed in its own comment block below.
 
+struct DeviceConfig;
+
 void loadConfigFromEEPROM();
-void parseConfig(const char* jsonConfig);
+bool parseConfig(const char* jsonConfig, DeviceConfig& cfg);
+void applyNetworkConfig();
+bool mergeDeviceConfig(const char* json, const DeviceConfig& cfg, char* out, size_t size);
+bool persistConfig(const DeviceConfig& cfg);
+bool persistConfigMode(const char* mode);
+bool applyConfigJson(const char* newJson);
+uint32_t configCrc32(const void* data, size_t len, uint32_t crc = 0);
+bool loadRtcConfigCache();
+void storeRtcConfigCache();
+struct WifiConnectCache;
+void beginStation(const WifiConnectCache* cache);
+void registerWifiEventHandlers();
+void superviseWiFi();
+bool loadWifiConnectCache(WifiConnectCache& cache);
+void storeWifiConnectCache();
+uint32_t dhcpLeaseSeconds();
+unsigned long wifiLeaseReuseMs(uint32_t leaseSeconds);
+void restartDevice();
+void storeRestartIntent(const char* mode);
+const char* takeRestartIntent();
 void setDeviceHostname();
 void startAPMode();
 void setAPSSID();
 void configureWebServerRoutes();
 void performFactoryReset();
-void saveConfigToEEPROM(const char* newConfig);
+bool saveConfigToEEPROM(const char* newConfig);
+bool saveConfigToEEPROM(const char* newConfig, const char* bootMode);
+uint8_t bootModeFlags(const char* mode);
+const char* storedBootMode();
 void sendHtmlHeader(const char* title);
 void sendHtmlFooter();
-void handleFavicon();
+void beginHtmlResponse();
+void sendHtml(const char* text);
+void sendHtml(const char* data, size_t length);
+void sendHtml(const __FlashStringHelper* text);
+void sendHtmlf(const char* format, ...);
+void endHtmlResponse();
+struct WebAsset;
+void serveAsset(const char* uri, const WebAsset& asset);
+bool sendNotModifiedIfCurrent(const char* etag, const char* cacheControl);
+bool etagListMatches(const char* list, const char* etag, bool weak);
+void pageETag(char* etag, size_t size, const char* content);
+void configETag(char* etag, size_t size);
+void checkStackHighWater(const char* where);
 
 // =====================================================================
 // Globals
 // =====================================================================
 // These are global variables used throughout the code.
 // - EEPROM_SIZE: Defines the allocated EEPROM space for config storage (2048 bytes; can be adjusted if more space needed).
-// - ssid, password: Store the WiFi network credentials loaded from config.
+// - DeviceConfig / deviceConfig: Typed copy of the config, parsed once at boot and after each save.
+//   Handlers and the boot path read from it instead of deserializing currentConfig on every request.
 // - ap_ssid: Dynamically generated AP SSID based on chip ID.
 // - ap_password: Hardcoded password for the AP (change for security in production).
 // - BUTTON_PIN: GPIO pin for the button (GPIO0 on ESP-01; uses internal pull-up).
-// - server: Instance of the web server on port 80.
+// - server: Instance of the web server on port 80 (AsyncHttpServer, or ESP8266WebServer with WEB_SERVER_LEGACY).
 // - button: Bounce2 instance for debounced button input.
-// - currentConfig: Buffer to hold the current JSON config from EEPROM.
+// - CONFIG_JOURNAL_SECTORS: Flash sectors at the end of the filesystem region used as an append-only config journal.
+//   - JournalSectorHeader: Starts each sector (magic, sequence, erase count, CRC32). The highest sequence is the newest sector.
+//   - JournalRecordHeader: Starts each appended record, followed by its payload. A snapshot holds the whole JSON;
+//     a patch holds only the changed byte range. Both carry a CRC32 of the record and of the resulting document.
+//   - JOURNAL_FLAG_BOOT_MODE, JOURNAL_FLAG_CONFIG_MODE: Record flags holding the boot mode (RUN or CONFIG), so it
+//     can be read from the header without parsing the JSON. The flag is the stored boot mode; every save sets it
+//     from the mode it was given (or, for a whole new document, from parseConfig()), never by scanning the text.
+//     The JSON configMode key is kept in step as a compatibility view; records written before the flag existed
+//     have flags 0 and fall back to parsing it.
+// - journalFlags: Flags of the newest applied record (the stored boot mode).
+// - journalSector, journalOffset: Sector holding the newest record and the next free byte in it (-1 if none).
+// - journalSequence, configGeneration: Sequence of the newest sector and generation of the loaded record.
+// - journalEraseCounts: Erase cycles per journal sector, kept in the sector headers for wear monitoring.
+// - configSavesWritten, configSavesSkipped, configBytesWritten: Saves that reached flash, saves skipped because
+//   nothing changed, and journal bytes written since boot.
+// - configQuiet: Silences the routine Serial messages of loading and saving the config (set by /bench, where
+//   printing a 2 KB config at 115200 baud would take longer than the work being timed).
+// - currentConfig: Buffer to hold the current JSON config from EEPROM. Mirrors the stored image and is only
+//   updated by saveConfigToEEPROM(), which diffs against it.
+// - RtcConfigCache / RTC_CONFIG_CACHE_OFFSET: Copy of deviceConfig kept in RTC user memory (survives soft restarts).
+//   A warm boot with a valid checksum skips the journal replay and JSON parse before WiFi.begin().
+//   Bump RTC_CONFIG_MAGIC whenever DeviceConfig changes layout.
+// - configFromRtc: True while deviceConfig came from the RTC cache and currentConfig is not loaded yet.
+// - configParsePending: True while a cold boot into CONFIG took its mode from the journal flag and deviceConfig
+//   still waits for parseConfig() in finishConfigLoad().
+// - WifiConnectCache: BSSID, channel and DHCP lease of the last successful STA connection, passed to WiFi.begin()
+//   to skip the scan. Kept in RTC memory after the config cache and, without the lease, at the start of the
+//   (otherwise unused) EEPROM area. WIFI_FAST_CONNECT_TIMEOUT bounds the cached attempt before a full scan.
+//   The lease carries its lifetime and its age at restartDevice(); WIFI_LEASE_REUSE_MAX caps how long after it
+//   was bound it is reused, WIFI_LEASE_RESTART_MARGIN allows for the restart itself.
+// - wifiLeaseSeconds, wifiLeaseBoundMs: Lifetime and bind time (millis()) of the current DHCP lease, 0 if there is
+//   none or it is too old to reuse. wifiLeaseApplied: The cached lease is set as a static config (beginStation());
+//   wifiDhcpRenewing: DHCP was restarted after that and has not bound yet.
+// - RestartIntent: Boot mode for the next soft restart only ("reboot into mode X once"), kept in RTC memory after
+//   the WiFi cache so it costs no flash write. restartIntent: The mode it selected for this boot, or nullptr.
+// - WIFI_CONNECT_TIMEOUT: Time allowed for the STA connection before falling back to AP mode.
+// - wifiState, wifiUsingCache: State of the STA connection state machine and whether the cached BSSID/channel is in use.
+// - wifiBeginTime, wifiAssocTime, wifiGotIpTime: Connect-phase timestamps; the last two are set by the WiFi event handlers.
+// - wifiDisconnectCount, wifiDisconnectReason: Disconnect events seen since WiFi.begin() and the last reason code.
+// - WIFI_RECONNECT_MIN_DELAY, WIFI_RECONNECT_MAX_DELAY: Bounds of the reconnect backoff after a RUN-mode link loss.
+// - wifiReconnectDelay, wifiNextAttemptTime, wifiOutageStart: Backoff state of the current outage.
+// - wifiApFallbackActive: True while the AP was started because an outage exceeded deviceConfig.apFallbackSec.
+// - wifiOutageCount, wifiOutageLastMs, wifiOutageLongestMs, wifiOutageTotalMs: Outage statistics since boot.
 // - currentState: Current device state (CONFIG or RUN).
-// - mode: String indicating boot mode ("RUN" or "CONFIG") from config.
 // - defaultConfigJson: Default JSON config applied on first boot or reset.
 //   - Includes network settings with defaults like "None" for SSID/password, DHCP enabled.
-// - css: PROGMEM-stored CSS for web interface styling (keeps it in flash memory to save RAM).
-// - database_icon_png: PROGMEM-stored favicon image data (PNG format, 16x16 pixels).
-// - database_icon_png_len: Length of the favicon data array.
+// - style_css_gz, favicon_png (include/web_assets.h): PROGMEM copies of web/style.css (gzip-compressed) and
+//   web/favicon.png (16x16), generated at build time by tools/gzip_assets.py with their lengths and strong ETags.
+// - WebAsset, styleCssAsset, faviconAsset: Static assets served by serveAsset() with ETag / 304 support.
+// - firmwareBuildId: Build timestamp mixed into the ETags of rendered pages, so a new firmware invalidates them.
+// - HTML_BUFFER_SIZE, htmlBuffer, htmlLength: Response buffer of sendHtml(). Pages are collected here and sent as
+//   one HTTP chunk per full buffer; the size leaves room for the chunk framing within one TCP segment (MSS 1460).
+// - htmlChunks, htmlBytes, htmlStartTime: Chunks, body bytes and start time of the page being sent.
+// - lastPageUri, lastPageChunks, lastPageBytes, lastPageMs: The same figures for the last completed page (see /status).
+// - scratchArena, scratchBorrowed, ScratchBuffer: Statically reserved EEPROM_SIZE work buffer for serializing a new
+//   config, borrowed by one ScratchBuffer at a time and released when it goes out of scope. Keeps 2 KB temporaries
+//   off the 4 KB continuation stack.
+// - JSON_POOL_SIZE, jsonPoolMemory, jsonPool: Static pool every JsonDocument allocates from (JsonDocument doc(&jsonPool)),
+//   so per-request JSON parsing no longer fragments the heap. Sized for two ~2 KB documents at once (the /api/config
+//   PATCH); usage, fragmentation and heap fallbacks are on /status.
+// - BENCH_RUNS, BENCH_SAVES, benchSizes (CONFIG_BENCH builds only): Timed runs per operation on /bench, runs of
+//   the flash-writing save, and the config sizes swept (0 = the default document, up to EEPROM_SIZE - 8).
+// - STACK_LOW_WATER, stackLowestFree, stackLowestWhere: Warning threshold, and the least free continuation stack
+//   seen by checkStackHighWater() and the checkpoint that first saw it (see /status).
 
 const int EEPROM_SIZE = 2048;
+const int JSON_MAX_DEPTH = 10; // ArduinoJson's default nesting limit
+#ifndef WEB_SERVER_LEGACY
+static_assert(HTTP_MAX_BODY_SIZE >= sizeof("jsondata=") - 1 + 3 * (EEPROM_SIZE - 1),
+              "The JSON editor's largest valid config must fit in a request body even if fully URL-encoded");
+#endif
+
+struct DeviceConfig {
+  char ssid[32];
+  char password[64];
+  bool useDhcp;
+  char staticIp[16];
+  char gateway[16];
+  char subnet[16];
+  char configMode[7]; // Boot mode either RUN or CONFIG
+  uint32_t apFallbackSec; // RUN-mode outage after which the AP is started (0 = never)
+};
+
+DeviceConfig deviceConfig = {};
 
-char ssid[32]     = "";
-char password[32] = "";
 char ap_ssid[20];
 const char* ap_password = "12345678";
 
 #define BUTTON_PIN 0  // GPIO0
 
+#ifdef WEB_SERVER_LEGACY
 ESP8266WebServer server(80);
+#else
+AsyncHttpServer server(80);
+#endif
 Bounce2::Button button = Bounce2::Button();
 
-char currentConfig[EEPROM_SIZE];
+const int CONFIG_JOURNAL_SECTORS = 4;
+const uint32_t JOURNAL_SECTOR_MAGIC = 0x314A4643; // "CFJ1"
+const uint32_t JOURNAL_RECORD_MAGIC = 0x32524643; // "CFR2"
+const uint8_t JOURNAL_RECORD_SNAPSHOT = 1;
+const uint8_t JOURNAL_RECORD_PATCH = 2;
+const uint8_t JOURNAL_FLAG_BOOT_MODE = 0x80;   // flags holds the boot mode
+const uint8_t JOURNAL_FLAG_CONFIG_MODE = 0x01; // Boot into CONFIG (else RUN)
+
+struct JournalSectorHeader {
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t eraseCount;
+  uint32_t crc;
+};
 
-DeviceState currentState;
+struct JournalRecordHeader {
+  uint32_t magic;
+  uint32_t generation;
+  uint8_t type;      // JOURNAL_RECORD_SNAPSHOT or JOURNAL_RECORD_PATCH
+  uint8_t flags;     // JOURNAL_FLAG_*: boot mode of the resulting document
+  uint16_t offset;   // Patch: first changed byte
+  uint16_t removed;  // Patch: bytes of the old document replaced
+  uint16_t length;   // Payload bytes following the header
+  uint32_t docCrc;   // CRC32 of the whole document after applying the record
+  uint32_t crc;      // CRC32 of the header fields from generation on, followed by the payload
+};
+
+enum JournalApplyResult {
+  JOURNAL_APPLIED,
+  JOURNAL_SKIPPED,
+  JOURNAL_INCONSISTENT
+};
+
+int journalSector = -1;
+uint32_t journalOffset = 0;
+uint32_t journalSequence = 0;
+uint32_t configGeneration = 0;
+uint8_t journalFlags = 0;
+uint32_t journalEraseCounts[CONFIG_JOURNAL_SECTORS];
+uint32_t configSavesWritten = 0;
+uint32_t configSavesSkipped = 0;
+uint32_t configBytesWritten = 0;
+bool configQuiet = false;
+
+alignas(4) char currentConfig[EEPROM_SIZE];
+
+const uint32_t RTC_CONFIG_CACHE_OFFSET = 0; // In 4-byte RTC user memory blocks
+const uint32_t RTC_CONFIG_MAGIC = 0x32435452; // "RTC2"
+
+struct RtcConfigCache {
+  uint32_t magic;
+  uint32_t crc;
+  uint32_t generation;
+  DeviceConfig config;
+};
+static_assert(sizeof(RtcConfigCache) % 4 == 0, "RTC memory is accessed in 4-byte blocks");
+
+bool configFromRtc = false;
+bool configParsePending = false;
+
+const uint32_t RTC_WIFI_CACHE_OFFSET = RTC_CONFIG_CACHE_OFFSET + sizeof(RtcConfigCache) / 4;
+const uint32_t WIFI_CACHE_MAGIC = 0x32434657; // "WFC2"
+const unsigned long WIFI_FAST_CONNECT_TIMEOUT = 3000;
+const unsigned long WIFI_CONNECT_TIMEOUT = 10000;
+const uint32_t WIFI_LEASE_REUSE_MAX = 86400; // Seconds
+const uint32_t WIFI_LEASE_RESTART_MARGIN = 5000; // ms
+const uint32_t WIFI_LEASE_UNSTAMPED = 0xFFFFFFFF;
+
+struct WifiConnectCache {
+  uint32_t magic;
+  uint32_t crc;
+  uint32_t ssidCrc;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t hasLease;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint32_t leaseSeconds;    // Lease time granted by the DHCP server
+  uint32_t leaseAgeMs;      // Time since the lease was bound, at restartDevice(); WIFI_LEASE_UNSTAMPED before
+};
+static_assert(sizeof(WifiConnectCache) % 4 == 0, "RTC memory is accessed in 4-byte blocks");
+
+const uint32_t RTC_RESTART_INTENT_OFFSET = RTC_WIFI_CACHE_OFFSET + sizeof(WifiConnectCache) / 4;
+const uint32_t RESTART_INTENT_MAGIC = 0x31544E49; // "INT1"
 
-char mode[7]; // Boot mode either RUN or CONFIG
+struct RestartIntent {
+  uint32_t magic;
+  uint32_t crc;
+  char mode[8];      // RUN or CONFIG
+};
+static_assert(sizeof(RestartIntent) % 4 == 0, "RTC memory is accessed in 4-byte blocks");
+static_assert(RTC_RESTART_INTENT_OFFSET * 4 + sizeof(RestartIntent) <= 512, "RTC user memory holds 512 bytes");
+
+const char* restartIntent = nullptr;
+
+WiFiEventHandler wifiConnectedHandler;
+WiFiEventHandler wifiGotIpHandler;
+WiFiEventHandler wifiDisconnectedHandler;
+WifiState wifiState = WIFI_STATE_IDLE;
+bool wifiUsingCache = false;
+unsigned long wifiBeginTime = 0;
+volatile unsigned long wifiAssocTime = 0;
+volatile unsigned long wifiGotIpTime = 0;
+volatile uint32_t wifiDisconnectCount = 0;
+volatile uint8_t wifiDisconnectReason = 0;
+uint32_t wifiLeaseSeconds = 0;
+unsigned long wifiLeaseBoundMs = 0;
+bool wifiLeaseApplied = false;
+bool wifiDhcpRenewing = false;
+
+const unsigned long WIFI_RECONNECT_MIN_DELAY = 1000;
+const unsigned long WIFI_RECONNECT_MAX_DELAY = 60000;
+
+unsigned long wifiReconnectDelay = 0;
+unsigned long wifiNextAttemptTime = 0;
+unsigned long wifiOutageStart = 0;
+bool wifiApFallbackActive = false;
+uint32_t wifiOutageCount = 0;
+unsigned long wifiOutageLastMs = 0;
+unsigned long wifiOutageLongestMs = 0;
+unsigned long wifiOutageTotalMs = 0;
+
+DeviceState currentState;
 
 const char* defaultConfigJson = R"(
 {
@@ -125,43 +398,65 @@ const char* defaultConfigJson = R"(
     "useDhcp": true,
     "staticIp": "",
     "gateway": "",
-    "subnet": ""
+    "subnet": "",
+    "apFallbackSec": 0
   },
   "configMode":"CONFIG"
 }
 )";
 
-const char* css PROGMEM = R"css(
-body { font-family: Arial, sans-serif; background-color: #f8f9fa; color: #212529; margin: 0; padding: 1rem; }
-header { background-color: #007bff; color: white; padding: 1rem; text-align: center; margin-bottom: 1rem; }
-header h1 { margin: 0; font-size: 2rem; color: white; }
-nav { background-color: #e9ecef; padding: 0.5rem; margin-bottom: 1rem; }
-nav ul { list-style-type: none; margin: 0; padding: 0; display: flex; justify-content: center; }
-nav li { margin: 0 1rem; position: relative; }
-nav a { color: #007bff; text-decoration: none; padding: 0.5rem; display: block; }
-nav a:hover { text-decoration: underline; }
-.dropdown-content { display: none; position: absolute; background-color: #f9f9f9; min-width: 160px; box-shadow: 0px 8px 16px 0px rgba(0,0,0,0.2); z-index: 1; }
-.dropdown-content a { color: black; padding: 0.75rem 1rem; text-decoration: none; display: block; }
-.dropdown-content a:hover { background-color: #f1f1f1; }
-.dropdown:hover .dropdown-content { display: block; }
-h1 { color: #007bff; }
-table { width: 100%; border-collapse: collapse; margin-bottom: 1rem; }
-th, td { border: 1px solid #dee2e6; padding: 0.75rem; text-align: left; }
-th { background-color: #e9ecef; font-weight: bold; }
-input[type="text"], textarea, select { width: 100%; padding: 0.5rem 1rem; border: 1px solid #ced4da; border-radius: 0.25rem; box-sizing: border-box; background-color: white; font-size: 1rem; line-height: 1.5; }
-input[type="submit"] { background-color: #007bff; color: white; padding: 0.5rem 1rem; border: none; border-radius: 0.25rem; cursor: pointer; }
-input[type="submit"]:hover { background-color: #0069d9; }
-input[type="radio"], input[type="checkbox"] { margin-right: 0.5rem; }
-table td:first-child, table th:first-child { width: 150px; }
-.fail { background-color: red; color: white; }
-.pass { background-color: green; color: white; }
-label { font-weight: bold; margin-bottom: 0.5rem; display: block; }
-)css";
-
-const uint8_t database_icon_png[] PROGMEM = {
-  0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x08, 0x06, 0x00, 0x00, 0x00, 0x1f, 0xf3, 0xff, 0x61, 0x00, 0x00, 0x00, 0xcf, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0xdd, 0x93, 0x21, 0x12, 0x83, 0x30, 0x10, 0x45, 0x5f, 0x48, 0x69, 0xd1, 0x58, 0x2e, 0x82, 0xac, 0xe1, 0x10, 0x38, 0xee, 0x81, 0xe1, 0x28, 0xdc, 0x03, 0x53, 0x01, 0xa6, 0x82, 0x41, 0xa1, 0x31, 0x08, 0x38, 0x40, 0x05, 0x4c, 0xba, 0x5d, 0x54, 0x90, 0xa6, 0x3, 0x6d, 0xd7, 0xed, 0xff, 0xb3, 0x3f, 0xfb, 0x37, 0xf3, 0x15, 0x8e, 0x2a, 0x8a, 0x42, 0x3e, 0x60, 0x6a, 0x8f, 0x79, 0x47, 0x87, 0x5d, 0xb8, 0x25, 0xe0, 0x1a, 0x76, 0xf1, 0x1f, 0x37, 0xf8, 0xa5, 0xfe, 0x40, 0xe0, 0xe4, 0x22, 0xf2, 0x3c, 0x67, 0x1c, 0x47, 0x44, 0x04, 0xad, 0x35, 0x6d, 0xdb, 0xd2, 0x75, 0x1d, 0x00, 0x2, 0xf2, 0x00, 0xee, 0x80, 0x72, 0x0a, 0x18, 0x63, 0x28, 0xcb, 0x12, 0x00, 0xdf, 0xf7, 0x49, 0xd3, 0x94, 0x65, 0x59, 0xe8, 0xfb, 0x1e, 0x60, 0x51, 0x4a, 0x5d, 0x0f, 0x5b, 0x58, 0xd7, 0x95, 0xaa, 0xaa, 0x88, 0xe3, 0xd8, 0xe2, 0x0e, 0xdf, 0x60, 0x9a, 0x26, 0xc2, 0x30, 0xb4, 0x70, 0xa7, 0x05, 0xeb, 0x25, 0xcf, 0xc3, 0x18, 0xb3, 0xb5, 0x67, 0x11, 0xb9, 0x1, 0x97, 0xc3, 0x2, 0x51, 0x14, 0x31, 0xcf, 0xf3, 0xd6, 0xfe, 0x76, 0x83, 0x20, 0x08, 0x48, 0x92, 0x84, 0xa6, 0x69, 0x2c, 0xce, 0xb9, 0x81, 0xd6, 0x9a, 0x2c, 0xcb, 0xde, 0xdf, 0x58, 0xd7, 0x35, 0xc3, 0x30, 0xec, 0x2d, 0x3c, 0xad, 0x78, 0xc2, 0xf7, 0x40, 0xed, 0x23, 0xfd, 0x2, 0xb2, 0x33, 0x54, 0x61, 0xf1, 0x24, 0x2a, 0x35, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+struct WebAsset {
+  const char* contentType;
+  const uint8_t* data;
+  size_t length;
+  const char* etag;
+  bool gzipped;
+};
+
+const WebAsset styleCssAsset = { "text/css", style_css_gz, style_css_gz_len, STYLE_CSS_ETAG, true };
+const WebAsset faviconAsset = { "image/png", favicon_png, favicon_png_len, FAVICON_PNG_ETAG, false };
+
+const char* firmwareBuildId = __DATE__ " " __TIME__;
+
+const size_t HTML_BUFFER_SIZE = 1460 - 8; // TCP MSS minus "5ac\r\n" chunk header and "\r\n" trailer
+char htmlBuffer[HTML_BUFFER_SIZE];
+size_t htmlLength = 0;
+uint16_t htmlChunks = 0;
+uint32_t htmlBytes = 0;
+unsigned long htmlStartTime = 0;
+char lastPageUri[32] = "";
+uint16_t lastPageChunks = 0;
+uint32_t lastPageBytes = 0;
+unsigned long lastPageMs = 0;
+
+alignas(4) char scratchArena[EEPROM_SIZE];
+bool scratchBorrowed = false;
+
+// Scoped borrow of scratchArena: data is nullptr if it is already borrowed (callers then give up cleanly).
+struct ScratchBuffer {
+  ScratchBuffer() : data(scratchBorrowed ? nullptr : scratchArena) { if (data) scratchBorrowed = true; }
+  ~ScratchBuffer() { if (data) scratchBorrowed = false; }
+  ScratchBuffer(const ScratchBuffer&) = delete;
+  ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+  static const size_t size = sizeof(scratchArena);
+  char* const data;
 };
-const size_t database_icon_png_len = 264;
+
+const size_t JSON_POOL_SIZE = 6144;
+alignas(8) uint8_t jsonPoolMemory[JSON_POOL_SIZE];
+JsonPoolAllocator jsonPool(jsonPoolMemory, sizeof(jsonPoolMemory));
+
+#ifdef CONFIG_BENCH
+const int BENCH_RUNS = 20;
+const int BENCH_SAVES = 4;
+const int BENCH_OPS = 4;
+const size_t benchSizes[] = { 0, 512, 1024, 1536, EEPROM_SIZE - 8 };
+const size_t BENCH_SIZE_COUNT = sizeof(benchSizes) / sizeof(benchSizes[0]);
+#endif
+
+const uint32_t STACK_LOW_WATER = 1024; // Warn when less continuation stack than this was ever left
+uint32_t stackLowestFree = UINT32_MAX;
+const char* stackLowestWhere = "none";
 
 // =====================================================================
 // Function Definitions
@@ -170,14 +465,12 @@ const size_t database_icon_png_len = 264;
 // initHardware()
 // Initializes hardware components.
 // - Starts Serial communication at 115200 baud for debugging.
-// - Initializes EEPROM with defined size.
 // - Sets up the button with debouncing (interval 5ms, pressed state LOW).
 // Call this first in setup() to prepare peripherals.
 
 void initHardware() {
   Serial.begin(115200);
   delay(100);
-  EEPROM.begin(EEPROM_SIZE);
   button.attach(BUTTON_PIN, INPUT_PULLUP);
   button.interval(5);
   button.setPressedState(LOW);
@@ -185,35 +478,143 @@ void initHardware() {
 
 // initConfig()
 // Loads and parses the configuration from EEPROM.
-// - Calls loadConfigFromEEPROM() to read config into currentConfig.
-// - Prints the loaded config to Serial.
-// - Parses the config to set global variables like ssid, password, mode.
+// - On a warm boot, restores deviceConfig from the RTC cache and leaves loading currentConfig to finishConfigLoad().
+// - Otherwise calls loadConfigFromEEPROM() to read config into currentConfig and prints it to Serial. The boot
+//   mode is read from the journal record flags (storedBootMode()) before anything is parsed: a boot into CONFIG
+//   leaves parseConfig() to finishConfigLoad(), so the AP comes up without a JSON parse. Otherwise, or when the
+//   newest record predates the flag, parses the config once into deviceConfig.
+// - Picks up a one-time restart intent (takeRestartIntent()) into restartIntent; deviceConfig keeps the stored mode.
+// - Applies the IP settings (once deviceConfig is parsed).
 // - Sets the device hostname based on chip ID.
 // Call this after initHardware() in setup().
 
 void initConfig() {
-  loadConfigFromEEPROM();
-  Serial.print("Config loaded: ");
-  Serial.println(currentConfig);
-  parseConfig(currentConfig);
+  configFromRtc = loadRtcConfigCache();
+  restartIntent = takeRestartIntent();
+  if (restartIntent) {
+    Serial.printf("Booting into %s once (restart intent).\n", restartIntent);
+  }
+  if (configFromRtc) {
+    Serial.println("Config restored from RTC cache.");
+  } else {
+    loadConfigFromEEPROM();
+    Serial.print("Config loaded: ");
+    Serial.println(currentConfig);
+    const char* bootMode = storedBootMode();
+    const char* mode = restartIntent ? restartIntent : bootMode;
+    if (bootMode && strcmp(mode, "CONFIG") == 0) {
+      strlcpy(deviceConfig.configMode, bootMode, sizeof(deviceConfig.configMode));
+      configParsePending = true;
+      Serial.println("Boot mode CONFIG from the journal header; config parse deferred.");
+    } else {
+      parseConfig(currentConfig, deviceConfig);
+      storeRtcConfigCache();
+    }
+  }
+  if (!configParsePending) {
+    applyNetworkConfig();
+  }
   setDeviceHostname();
 }
 
+// finishConfigLoad()
+// Completes a warm boot by loading currentConfig and the journal state from flash.
+// - After a cold boot into CONFIG (configParsePending), parses the config that initConfig() deferred, applies
+//   the IP settings and stores the RTC cache instead.
+// - Does nothing if initConfig() already took the full path.
+// - If the stored generation differs from the cached one, re-parses and re-applies the config.
+// Call this after initWiFi() in setup(), so the journal replay (or the deferred parse) runs while the STA
+// connection or the AP comes up.
+
+void finishConfigLoad() {
+  if (configParsePending) {
+    configParsePending = false;
+    parseConfig(currentConfig, deviceConfig);
+    applyNetworkConfig();
+    storeRtcConfigCache();
+    return;
+  }
+  if (!configFromRtc) return;
+  uint32_t cachedGeneration = configGeneration;
+  loadConfigFromEEPROM();
+  configFromRtc = false;
+  if (configGeneration != cachedGeneration) {
+    Serial.println("RTC cache was stale; re-applying stored config.");
+    parseConfig(currentConfig, deviceConfig);
+    applyNetworkConfig();
+    storeRtcConfigCache();
+  }
+}
+
+// rtcConfigCacheChecksum(const RtcConfigCache& cache)
+// Computes the CRC32 of the cached generation and DeviceConfig.
+
+uint32_t rtcConfigCacheChecksum(const RtcConfigCache& cache)
+{
+  return configCrc32(&cache.generation, sizeof(cache) - offsetof(RtcConfigCache, generation));
+}
+
+// loadRtcConfigCache()
+// Restores deviceConfig and configGeneration from RTC user memory.
+// - Only after a soft restart or deep-sleep wake; power-on and external resets take the cold path.
+// - Returns false if the magic or CRC32 does not match (e.g. RTC memory holds garbage after power loss).
+
+bool loadRtcConfigCache()
+{
+  uint32_t reason = ESP.getResetInfoPtr()->reason;
+  if (reason != REASON_SOFT_RESTART && reason != REASON_DEEP_SLEEP_AWAKE) {
+    return false;
+  }
+  RtcConfigCache cache;
+  if (!ESP.rtcUserMemoryRead(RTC_CONFIG_CACHE_OFFSET, (uint32_t*)&cache, sizeof(cache))) {
+    return false;
+  }
+  if (cache.magic != RTC_CONFIG_MAGIC || cache.crc != rtcConfigCacheChecksum(cache)) {
+    return false;
+  }
+  deviceConfig = cache.config;
+  configGeneration = cache.generation;
+  return true;
+}
+
+// storeRtcConfigCache()
+// Writes deviceConfig and configGeneration to RTC user memory for the next warm boot.
+// Call this whenever deviceConfig has been parsed or changed and persisted.
+
+void storeRtcConfigCache()
+{
+  RtcConfigCache cache;
+  cache.magic = RTC_CONFIG_MAGIC;
+  cache.generation = configGeneration;
+  cache.config = deviceConfig;
+  cache.crc = rtcConfigCacheChecksum(cache);
+  ESP.rtcUserMemoryWrite(RTC_CONFIG_CACHE_OFFSET, (uint32_t*)&cache, sizeof(cache));
+}
+
+// invalidateRtcConfigCache()
+// Clears the RTC cache so the next boot takes the full load path. Called on factory reset.
+
+void invalidateRtcConfigCache()
+{
+  uint32_t zero = 0;
+  ESP.rtcUserMemoryWrite(RTC_CONFIG_CACHE_OFFSET, &zero, sizeof(zero));
+}
+
 // initWiFi()
-// Initializes WiFi based on current config and mode.
+// Initializes WiFi based on current config and mode without waiting for the connection.
 // - If mode is "CONFIG" or no valid SSID, starts AP mode and returns STATE_CONFIG.
-// - Otherwise, attempts to connect to the specified WiFi network.
-// - Supports password-protected or open networks.
-// - Timeout: 10 seconds for connection attempt.
-// - On success, prints IP and returns STATE_RUN.
-// - On failure, falls back to AP mode and STATE_CONFIG.
-// - Applies static IP or DHCP as per config.
+// - Otherwise, starts connecting to the specified WiFi network and returns STATE_RUN right away;
+//   updateWiFi() drives the connection from loop() (see WifiState).
+// - Tries the BSSID/channel of the last connection first (see beginStation()).
+// - Reads the settings from deviceConfig; the static IP or DHCP setup was applied in initConfig().
 // Returns the determined DeviceState.
 // Call this after initConfig() in setup().
 
 DeviceState initWiFi() 
 {
   Serial.println("Connecting to Wi-Fi...");
+  const char* ssid = deviceConfig.ssid;
+  const char* mode = restartIntent ? restartIntent : deviceConfig.configMode;
   if (strcmp(mode, "CONFIG") == 0 || strlen(ssid) == 0 || strcmp(ssid, "None") == 0) 
   {
     startAPMode();
@@ -222,43 +623,352 @@ DeviceState initWiFi()
   else
   {
     WiFi.disconnect(true);
-    delay(500);
-    // Avoid parsing config again in CONFIG mode to reduce CPU load
-    if (currentState != STATE_CONFIG) 
-    {
-      parseConfig(currentConfig);
-      Serial.print("Applying config: ");
-      Serial.println(currentConfig);
+    WiFi.setAutoReconnect(false); // superviseWiFi() owns reconnects and their backoff
+    registerWifiEventHandlers();
+    WifiConnectCache cache;
+    wifiUsingCache = loadWifiConnectCache(cache);
+    wifiBeginTime = millis();
+    beginStation(wifiUsingCache ? &cache : nullptr);
+    wifiState = WIFI_STATE_CONNECTING;
+    return STATE_RUN;
+  }
+}
+
+// updateWiFi()
+// Steps the STA connection state machine; call it from every loop() iteration.
+// - CONNECTING: Waits for the got-IP event. If the cached BSSID/channel attempt reports a disconnect or takes longer
+//   than WIFI_FAST_CONNECT_TIMEOUT, restores the configured IP settings and moves to RETRYING with a full scan.
+// - CONNECTING/RETRYING: On got-IP, prints IP and connect-phase timings, updates the connect cache and moves to
+//   CONNECTED. After WIFI_CONNECT_TIMEOUT in total, falls back to AP mode (FAILED_AP, STATE_CONFIG).
+// - If the connection came up on the cached lease (a static config), restarts DHCP on it right away, so the lease
+//   is renewed with the server and kept up by lwIP from then on; superviseWiFi() stores the new lease.
+// Never blocks, so the web server and button stay live while the link comes up.
+
+void updateWiFi()
+{
+  if (wifiState == WIFI_STATE_CONNECTED || wifiState == WIFI_STATE_RECONNECTING) {
+    superviseWiFi();
+    return;
+  }
+  if (wifiState != WIFI_STATE_CONNECTING && wifiState != WIFI_STATE_RETRYING) {
+    return;
+  }
+  unsigned long elapsed = millis() - wifiBeginTime;
+  if (wifiGotIpTime != 0) 
+  {
+    IPAddress localIP = WiFi.localIP();
+    char ipBuf[16];
+    snprintf(ipBuf, sizeof(ipBuf), "%d.%d.%d.%d", localIP[0], localIP[1], localIP[2], localIP[3]);
+    Serial.print("Connected: ");
+    Serial.println(ipBuf);
+    Serial.printf("Time to connected: %lu ms since boot\n", millis());
+    Serial.printf("WiFi timing (%s): associated after %lu ms, IP after %lu ms\n",
+                  wifiState == WIFI_STATE_CONNECTING && wifiUsingCache ? "cached BSSID/channel" : "full scan",
+                  wifiAssocTime - wifiBeginTime, wifiGotIpTime - wifiBeginTime);
+    storeWifiConnectCache();
+    if (wifiLeaseApplied) {
+      Serial.println("Renewing the cached DHCP lease.");
+      wifiLeaseApplied = false;
+      wifiDhcpRenewing = true;
+      wifiGotIpTime = 0;
+      applyNetworkConfig();
     }
-    if (strlen(password) > 0 && strcmp(password, "None") != 0) 
-    {
-      WiFi.begin(ssid, password);
+    wifiDisconnectCount = 0;
+    wifiState = WIFI_STATE_CONNECTED;
+  }
+  else if (wifiState == WIFI_STATE_CONNECTING && wifiUsingCache &&
+           (wifiDisconnectCount > 0 || elapsed > WIFI_FAST_CONNECT_TIMEOUT)) 
+  {
+    Serial.println("Fast connect failed; falling back to full scan.");
+    applyNetworkConfig();
+    beginStation(nullptr);
+    wifiState = WIFI_STATE_RETRYING;
+  }
+  else if (elapsed > WIFI_CONNECT_TIMEOUT) 
+  {
+    Serial.println("WiFi connection timed out.");
+    startAPMode();
+    currentState = STATE_CONFIG;
+    wifiState = WIFI_STATE_FAILED_AP;
+  }
+}
+
+// superviseWiFi()
+// Watches the STA link once connected and reconnects after a loss; called by updateWiFi().
+// - CONNECTED: Stores the lease once DHCP has bound after a fast connect (see updateWiFi()), and stops offering
+//   the lease for reuse once it is older than wifiLeaseReuseMs(). A disconnect event starts an outage: counts it
+//   and schedules the first attempt.
+// - RECONNECTING: Issues WiFi.begin() (full scan, the AP may have moved channel) when the backoff expires,
+//   doubling the delay up to WIFI_RECONNECT_MAX_DELAY with random jitter so many devices do not retry in step.
+//   After deviceConfig.apFallbackSec of outage (if non-zero), also starts the AP so the device can be reconfigured;
+//   the AP is stopped again once the link is back.
+// - On got-IP, records the outage duration and returns to CONNECTED.
+// Never blocks, so server.handleClient() and the RUN-mode application keep running during an outage.
+
+void superviseWiFi()
+{
+  unsigned long now = millis();
+  if (wifiState == WIFI_STATE_CONNECTED) {
+    if (wifiDhcpRenewing && wifiGotIpTime != 0) {
+      wifiDhcpRenewing = false;
+      storeWifiConnectCache();
     }
-    else 
-    {
-      WiFi.begin(ssid);
+    if (wifiLeaseSeconds && now - wifiLeaseBoundMs >= wifiLeaseReuseMs(wifiLeaseSeconds)) {
+      wifiLeaseSeconds = 0;
     }
+    if (wifiDisconnectCount == 0) return;
+    Serial.printf("WiFi link lost (reason %u); reconnecting.\n", wifiDisconnectReason);
+    wifiOutageCount++;
+    wifiOutageStart = now;
+    wifiReconnectDelay = WIFI_RECONNECT_MIN_DELAY;
+    wifiNextAttemptTime = now + WIFI_RECONNECT_MIN_DELAY;
+    wifiGotIpTime = 0;
+    wifiState = WIFI_STATE_RECONNECTING;
+    return;
+  }
 
-    unsigned long startAttemptTime = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < 10000) {
-      delay(250);
-      Serial.print(".");
+  if (wifiGotIpTime != 0) {
+    wifiOutageLastMs = now - wifiOutageStart;
+    wifiOutageTotalMs += wifiOutageLastMs;
+    if (wifiOutageLastMs > wifiOutageLongestMs) wifiOutageLongestMs = wifiOutageLastMs;
+    Serial.printf("WiFi link restored after %lu ms.\n", wifiOutageLastMs);
+    if (wifiApFallbackActive) {
+      WiFi.softAPdisconnect(true);
+      wifiApFallbackActive = false;
+      currentState = STATE_RUN;
     }
-    if (WiFi.status() == WL_CONNECTED) 
-    {
-      IPAddress localIP = WiFi.localIP();
-      char ipBuf[16];
-      snprintf(ipBuf, sizeof(ipBuf), "%d.%d.%d.%d", localIP[0], localIP[1], localIP[2], localIP[3]);
-      Serial.print("\nConnected: ");
-      Serial.println(ipBuf);
-      return STATE_RUN;
+    wifiDhcpRenewing = false;
+    storeWifiConnectCache();
+    wifiDisconnectCount = 0;
+    wifiState = WIFI_STATE_CONNECTED;
+    return;
+  }
+
+  if (!wifiApFallbackActive && deviceConfig.apFallbackSec > 0 &&
+      now - wifiOutageStart >= deviceConfig.apFallbackSec * 1000UL) {
+    Serial.println("WiFi outage exceeded AP fallback time.");
+    startAPMode();
+    wifiApFallbackActive = true;
+    currentState = STATE_CONFIG;
+  }
+
+  if ((long)(now - wifiNextAttemptTime) >= 0) {
+    wifiBeginTime = now;
+    wifiAssocTime = 0;
+    beginStation(nullptr);
+    wifiReconnectDelay = min(wifiReconnectDelay * 2, WIFI_RECONNECT_MAX_DELAY);
+    wifiNextAttemptTime = now + wifiReconnectDelay / 2 + random(wifiReconnectDelay / 2);
+  }
+}
+
+// beginStation(const WifiConnectCache* cache)
+// Calls WiFi.begin() with the credentials from deviceConfig.
+// - With a cache, passes its channel and BSSID so the SDK skips the full scan.
+// - If the cache also holds a DHCP lease (loadWifiConnectCache() only keeps one that is fresh) and the config
+//   uses DHCP, applies it as a static config so the DHCP exchange is skipped too; updateWiFi() hands the address
+//   back to DHCP once connected.
+// - Supports password-protected or open networks.
+
+void beginStation(const WifiConnectCache* cache)
+{
+  const char* password = deviceConfig.password;
+  if (strlen(password) == 0 || strcmp(password, "None") == 0) {
+    password = nullptr;
+  }
+  wifiLeaseApplied = cache && cache->hasLease && deviceConfig.useDhcp;
+  if (wifiLeaseApplied) {
+    WiFi.config(IPAddress(cache->ip), IPAddress(cache->gateway), IPAddress(cache->subnet), IPAddress(cache->dns));
+  }
+  if (cache) {
+    WiFi.begin(deviceConfig.ssid, password, cache->channel, cache->bssid);
+  } else {
+    WiFi.begin(deviceConfig.ssid, password);
+  }
+}
+
+// registerWifiEventHandlers()
+// Registers the STA event handlers that feed updateWiFi().
+// - Records when the station associates and when it gets an IP (also used for the connect-phase timing log).
+// - Counts disconnect events and keeps the last reason.
+// The handlers only store values; they run from the WiFi event callback, updateWiFi() acts on them.
+
+void registerWifiEventHandlers()
+{
+  wifiAssocTime = wifiGotIpTime = 0;
+  wifiDisconnectCount = 0;
+  wifiConnectedHandler = WiFi.onStationModeConnected([](const WiFiEventStationModeConnected&) {
+    wifiAssocTime = millis();
+  });
+  wifiGotIpHandler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP&) {
+    wifiGotIpTime = millis();
+  });
+  wifiDisconnectedHandler = WiFi.onStationModeDisconnected([](const WiFiEventStationModeDisconnected& event) {
+    wifiDisconnectCount++;
+    wifiDisconnectReason = event.reason;
+  });
+}
+
+// wifiConnectCacheChecksum(const WifiConnectCache& cache)
+// Computes the CRC32 of everything in the cache after the crc field.
+
+uint32_t wifiConnectCacheChecksum(const WifiConnectCache& cache)
+{
+  return configCrc32(&cache.ssidCrc, sizeof(cache) - offsetof(WifiConnectCache, ssidCrc));
+}
+
+// wifiLeaseReuseMs(uint32_t leaseSeconds)
+// How long after it was bound a lease may be reused: half its lifetime (T1, when a DHCP client starts to renew),
+// at most WIFI_LEASE_REUSE_MAX. Renewals by lwIP are not counted, so a lease may be refused while still valid but
+// never reused after it ran out.
+
+unsigned long wifiLeaseReuseMs(uint32_t leaseSeconds)
+{
+  return min(leaseSeconds / 2, WIFI_LEASE_REUSE_MAX) * 1000UL;
+}
+
+// loadWifiConnectCache(WifiConnectCache& cache)
+// Loads the BSSID/channel (and lease) of the last successful connection.
+// - After a soft restart, prefers the copy in RTC memory, which also carries the DHCP lease.
+// - The lease is kept only after restartDevice() stamped its age, and only while that age plus the uptime of this
+//   boot and WIFI_LEASE_RESTART_MARGIN is below wifiLeaseReuseMs(); the time spent in deep sleep, a crash or
+//   without power is unknown. It is cleared in RTC memory as it is taken, so it serves one boot only.
+// - Otherwise uses the copy in the EEPROM area, which holds only BSSID and channel.
+// - Returns false if no valid cache exists or it was recorded for a different SSID.
+
+bool loadWifiConnectCache(WifiConnectCache& cache)
+{
+  uint32_t ssidCrc = configCrc32(deviceConfig.ssid, strlen(deviceConfig.ssid));
+  uint32_t reason = ESP.getResetInfoPtr()->reason;
+  if (reason == REASON_SOFT_RESTART || reason == REASON_DEEP_SLEEP_AWAKE) {
+    ESP.rtcUserMemoryRead(RTC_WIFI_CACHE_OFFSET, (uint32_t*)&cache, sizeof(cache));
+    if (cache.magic == WIFI_CACHE_MAGIC && cache.crc == wifiConnectCacheChecksum(cache) && cache.ssidCrc == ssidCrc) {
+      if (cache.hasLease) {
+        uint64_t ageMs = (uint64_t)cache.leaseAgeMs + millis() + WIFI_LEASE_RESTART_MARGIN;
+        bool fresh = reason == REASON_SOFT_RESTART && cache.leaseAgeMs != WIFI_LEASE_UNSTAMPED &&
+                     ageMs < wifiLeaseReuseMs(cache.leaseSeconds);
+        cache.hasLease = 0;
+        cache.crc = wifiConnectCacheChecksum(cache);
+        ESP.rtcUserMemoryWrite(RTC_WIFI_CACHE_OFFSET, (uint32_t*)&cache, sizeof(cache));
+        cache.hasLease = fresh;
+      }
+      return true;
     }
-    else 
-    {
-      startAPMode();
-      return STATE_CONFIG;
+  }
+  EEPROM.begin(sizeof(WifiConnectCache));
+  EEPROM.get(0, cache);
+  EEPROM.end();
+  cache.hasLease = 0;
+  return cache.magic == WIFI_CACHE_MAGIC && cache.crc == wifiConnectCacheChecksum(cache) && cache.ssidCrc == ssidCrc;
+}
+
+// storeWifiConnectCache()
+// Saves the BSSID, channel and DHCP lease of the current connection.
+// - The RTC copy keeps the lease if the DHCP server granted the current address (not while the cached lease is
+//   applied as a static config), with its lifetime; restartDevice() adds its age. The EEPROM copy drops it because
+//   a lease may have expired by the next cold boot.
+// - EEPROM.commit() only touches flash when the BSSID or channel actually changed.
+// Call this after the station got an IP.
+
+void storeWifiConnectCache()
+{
+  WifiConnectCache cache;
+  memset(&cache, 0, sizeof(cache));
+  cache.magic = WIFI_CACHE_MAGIC;
+  cache.ssidCrc = configCrc32(deviceConfig.ssid, strlen(deviceConfig.ssid));
+  memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+  cache.channel = WiFi.channel();
+  wifiLeaseSeconds = deviceConfig.useDhcp ? dhcpLeaseSeconds() : 0;
+  wifiLeaseBoundMs = wifiGotIpTime;
+  cache.hasLease = wifiLeaseSeconds > 0;
+  cache.ip = WiFi.localIP();
+  cache.gateway = WiFi.gatewayIP();
+  cache.subnet = WiFi.subnetMask();
+  cache.dns = WiFi.dnsIP();
+  cache.leaseSeconds = wifiLeaseSeconds;
+  cache.leaseAgeMs = WIFI_LEASE_UNSTAMPED;
+  cache.crc = wifiConnectCacheChecksum(cache);
+  ESP.rtcUserMemoryWrite(RTC_WIFI_CACHE_OFFSET, (uint32_t*)&cache, sizeof(cache));
+
+  cache.hasLease = 0;
+  cache.ip = cache.gateway = cache.subnet = cache.dns = cache.leaseSeconds = 0;
+  cache.crc = wifiConnectCacheChecksum(cache);
+  EEPROM.begin(sizeof(WifiConnectCache));
+  EEPROM.put(0, cache);
+  EEPROM.commit();
+  EEPROM.end();
+}
+
+// dhcpLeaseSeconds()
+// Returns the lease time the DHCP server granted for the station's current address, or 0 if the address did not
+// come from DHCP (a static config, including the cached lease applied by beginStation()).
+
+uint32_t dhcpLeaseSeconds()
+{
+  uint32_t ip = WiFi.localIP();
+  for (struct netif* intf = netif_list; intf; intf = intf->next) {
+    if (ip4_addr_get_u32(netif_ip4_addr(intf)) == ip && dhcp_supplied_address(intf)) {
+      return netif_dhcp_data(intf)->offered_t0_lease;
     }
   }
+  return 0;
+}
+
+// restartDevice()
+// ESP.restart() for the sketch's restarts (mode toggle, /restart). Stamps the age of the current DHCP lease into
+// the RTC WiFi cache first, so the next boot can tell whether the lease is still fresh; without the stamp (any
+// other reset) the lease is not reused.
+
+void restartDevice()
+{
+  WifiConnectCache cache;
+  ESP.rtcUserMemoryRead(RTC_WIFI_CACHE_OFFSET, (uint32_t*)&cache, sizeof(cache));
+  if (wifiLeaseSeconds && cache.magic == WIFI_CACHE_MAGIC && cache.crc == wifiConnectCacheChecksum(cache) &&
+      cache.hasLease) {
+    cache.leaseAgeMs = millis() - wifiLeaseBoundMs;
+    cache.crc = wifiConnectCacheChecksum(cache);
+    ESP.rtcUserMemoryWrite(RTC_WIFI_CACHE_OFFSET, (uint32_t*)&cache, sizeof(cache));
+  }
+  ESP.restart();
+}
+
+// restartIntentChecksum(const RestartIntent& intent)
+// Computes the CRC32 of the mode field.
+
+uint32_t restartIntentChecksum(const RestartIntent& intent)
+{
+  return configCrc32(intent.mode, sizeof(intent.mode));
+}
+
+// storeRestartIntent(const char* mode)
+// Makes the next soft restart boot into mode ("RUN" or "CONFIG") once, without changing the stored config.
+// Call this right before restartDevice().
+
+void storeRestartIntent(const char* mode)
+{
+  RestartIntent intent;
+  memset(&intent, 0, sizeof(intent));
+  intent.magic = RESTART_INTENT_MAGIC;
+  strlcpy(intent.mode, mode, sizeof(intent.mode));
+  intent.crc = restartIntentChecksum(intent);
+  ESP.rtcUserMemoryWrite(RTC_RESTART_INTENT_OFFSET, (uint32_t*)&intent, sizeof(intent));
+}
+
+// takeRestartIntent()
+// Returns the boot mode stored by storeRestartIntent() and clears it, so it applies to one boot only.
+// - Only honoured after a soft restart; RTC memory holds garbage after a power loss.
+// - Returns nullptr if there is no valid intent.
+
+const char* takeRestartIntent()
+{
+  if (ESP.getResetInfoPtr()->reason != REASON_SOFT_RESTART) return nullptr;
+  RestartIntent intent;
+  ESP.rtcUserMemoryRead(RTC_RESTART_INTENT_OFFSET, (uint32_t*)&intent, sizeof(intent));
+  if (intent.magic != RESTART_INTENT_MAGIC || intent.crc != restartIntentChecksum(intent)) return nullptr;
+  uint32_t zero = 0;
+  ESP.rtcUserMemoryWrite(RTC_RESTART_INTENT_OFFSET, &zero, sizeof(zero));
+  if (strcmp(intent.mode, "CONFIG") == 0) return "CONFIG";
+  if (strcmp(intent.mode, "RUN") == 0) return "RUN";
+  return nullptr;
 }
 
 // startAPMode()
@@ -284,12 +994,21 @@ void startAPMode() {
 
 // initWebServer()
 // Sets up the web server.
+// - Collects the request headers the handlers read (If-None-Match for conditional GET; If-Match and
+//   Content-Type for /api/config).
+// - Keeps connections open between requests (keep-alive), so a page and its stylesheet/favicon share one TCP
+//   handshake; tune the idle timeout and requests per connection here.
 // - Calls configureWebServerRoutes() to define HTTP handlers.
 // - Starts the server.
 // - Prints confirmation to Serial.
 // Call this after initWiFi() in setup(). The server runs in both modes but is primarily for CONFIG.
 
 void initWebServer() {
+  const char* headerKeys[] = { "If-None-Match", "If-Match", "Content-Type" };
+  server.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+#ifndef WEB_SERVER_LEGACY
+  server.setKeepAlive(5000, 20); // Idle timeout (ms), requests per connection
+#endif
   configureWebServerRoutes();
   server.begin();
   Serial.println("Web server started.");
@@ -298,7 +1017,8 @@ void initWebServer() {
 // handleButton()
 // Handles button input in the loop().
 // - Uses debouncing via Bounce2.
-// - Short press (>2s <20s): Toggles between RUN and CONFIG modes, saves to EEPROM, restarts.
+// - Short press (>2s <20s): Toggles deviceConfig.configMode between RUN and CONFIG, saves it (persistConfigMode()), restarts.
+//   Toggles away from the mode the device is running in, which after a one-time restart intent is not the stored one.
 // - Long press (>=20s): Performs factory reset.
 // Call this repeatedly in loop() for button monitoring.
 
@@ -313,25 +1033,13 @@ void handleButton() {
     if (duration > 2000 && duration < 20000) {
       // Short press over 2 seconds: Toggle mode
       Serial.println("Short press detected (over 2s), toggling mode...");
-      StaticJsonDocument<512> doc;
-      DeserializationError error = deserializeJson(doc, currentConfig);
-      if (!error) {
-        const char* currentMode = doc["configMode"] | "RUN";
-        const char* newMode = strcmp(currentMode, "CONFIG") == 0 ? "RUN" : "CONFIG";
-        doc["configMode"] = newMode;
-        char newJson[EEPROM_SIZE];
-        serializeJson(doc, newJson, sizeof(newJson));
+      const char* mode = restartIntent ? restartIntent : deviceConfig.configMode;
+      const char* newMode = strcmp(mode, "CONFIG") == 0 ? "RUN" : "CONFIG";
+      if (persistConfigMode(newMode)) {
         Serial.print("New config JSON: ");
-        Serial.println(newJson);
-        saveConfigToEEPROM(newJson);
-        strcpy(currentConfig, newJson);
+        Serial.println(currentConfig);
         Serial.println("Mode toggled, restarting...");
-        ESP.restart();
-      } 
-      else 
-      {
-        Serial.print("JSON parse error in button toggle: ");
-        Serial.println(error.c_str());
+        restartDevice();
       }
     }
   }
@@ -340,54 +1048,439 @@ void handleButton() {
   }
 }
 
+// configCrc32(const void* data, size_t len, uint32_t crc)
+// Standard CRC-32 (reflected, polynomial 0xEDB88320) over a byte range.
+// - Pass the previous result as crc to continue a checksum across several ranges.
+// Used to validate config journal headers and records before they are trusted at boot.
+
+uint32_t configCrc32(const void* data, size_t len, uint32_t crc)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  crc = ~crc;
+  while (len--) {
+    crc ^= *bytes++;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// journalSectorAddress(int sector)
+// Returns the flash address of a config journal sector.
+// - Journal sectors are the last CONFIG_JOURNAL_SECTORS sectors of the filesystem region.
+
+uint32_t journalSectorAddress(int sector)
+{
+  uint32_t firstSector = (FS_PHYS_ADDR + FS_PHYS_SIZE) / SPI_FLASH_SEC_SIZE - CONFIG_JOURNAL_SECTORS;
+  return (firstSector + sector) * SPI_FLASH_SEC_SIZE;
+}
+
+// configJournalAvailable()
+// Returns true if the flash layout reserves enough filesystem sectors for the config journal.
+// Boards built with a no-filesystem layout (e.g. eagle.flash.512k.ld) cannot store config.
+
+bool configJournalAvailable()
+{
+  return FS_PHYS_SIZE >= CONFIG_JOURNAL_SECTORS * SPI_FLASH_SEC_SIZE;
+}
+
+// journalRecordSize(uint32_t length)
+// Returns the flash space taken by a record with a payload of length bytes (header plus payload, word aligned).
+
+uint32_t journalRecordSize(uint32_t length)
+{
+  return sizeof(JournalRecordHeader) + ((length + 3) & ~3u);
+}
+
+// journalHeaderChecksum(const JournalRecordHeader& header)
+// Starts the record CRC32 over the header fields from generation up to docCrc; the payload is added after.
+
+uint32_t journalHeaderChecksum(const JournalRecordHeader& header)
+{
+  return configCrc32(&header.generation, offsetof(JournalRecordHeader, crc) - offsetof(JournalRecordHeader, generation));
+}
+
+// readJournalSectorHeader(int sector, JournalSectorHeader& header)
+// Reads a sector header from flash.
+// - Returns false for an erased sector, a wrong magic or a header whose CRC32 does not match.
+
+bool readJournalSectorHeader(int sector, JournalSectorHeader& header)
+{
+  if (!ESP.flashRead(journalSectorAddress(sector), (uint32_t*)&header, sizeof(header))) {
+    return false;
+  }
+  return header.magic == JOURNAL_SECTOR_MAGIC &&
+         header.crc == configCrc32(&header, offsetof(JournalSectorHeader, crc));
+}
+
+// applyJournalRecord(uint32_t address, const JournalRecordHeader& header, size_t& docLength)
+// Applies one record to the document held in currentConfig (docLength bytes).
+// - A snapshot replaces the whole document; a patch replaces header.removed bytes at header.offset with the payload.
+// - The payload is checked against the record CRC32 before currentConfig is touched, reading flash in small chunks.
+// Returns JOURNAL_SKIPPED for a torn or out-of-range record (document unchanged), JOURNAL_INCONSISTENT if the result
+// does not match header.docCrc (document modified; replay must stop before this record), else JOURNAL_APPLIED.
+
+JournalApplyResult applyJournalRecord(uint32_t address, const JournalRecordHeader& header, size_t& docLength)
+{
+  uint32_t offset = header.type == JOURNAL_RECORD_SNAPSHOT ? 0 : header.offset;
+  uint32_t removed = header.type == JOURNAL_RECORD_SNAPSHOT ? docLength : header.removed;
+  if (offset + removed > docLength || docLength - removed + header.length >= (size_t)EEPROM_SIZE) {
+    return JOURNAL_SKIPPED;
+  }
+
+  uint32_t chunk[64];
+  uint32_t crc = journalHeaderChecksum(header);
+  for (uint32_t pos = 0; pos < header.length; pos += sizeof(chunk)) {
+    size_t n = min((size_t)(header.length - pos), sizeof(chunk));
+    if (!ESP.flashRead(address + sizeof(JournalRecordHeader) + pos, chunk, (n + 3) & ~3u)) {
+      return JOURNAL_SKIPPED;
+    }
+    crc = configCrc32(chunk, n, crc);
+  }
+  if (crc != header.crc) {
+    return JOURNAL_SKIPPED;
+  }
+
+  memmove(currentConfig + offset + header.length, currentConfig + offset + removed, docLength - offset - removed);
+  for (uint32_t pos = 0; pos < header.length; pos += sizeof(chunk)) {
+    size_t n = min((size_t)(header.length - pos), sizeof(chunk));
+    ESP.flashRead(address + sizeof(JournalRecordHeader) + pos, chunk, (n + 3) & ~3u);
+    memcpy(currentConfig + offset + pos, chunk, n);
+  }
+  docLength = docLength - removed + header.length;
+  currentConfig[docLength] = 0;
+  return configCrc32(currentConfig, docLength) == header.docCrc ? JOURNAL_APPLIED : JOURNAL_INCONSISTENT;
+}
+
+// replayJournalSector(int sector, uint32_t limit, uint32_t& endOffset, uint32_t& badOffset)
+// Replays the records of one journal sector below limit into currentConfig.
+// - Walks record headers from the start of the sector until erased flash; the scan is bounded by the sector size.
+// - Records with a bad CRC (torn by a power loss) are skipped; a torn header closes the rest of the sector.
+// - A patch that does not reproduce its docCrc stops the replay and reports its offset in badOffset.
+// - Sets endOffset to the first free byte (SPI_FLASH_SEC_SIZE if the sector is full or closed).
+// Returns true if at least one snapshot was applied; configGeneration and journalFlags are set from the last
+// applied record.
+
+bool replayJournalSector(int sector, uint32_t limit, uint32_t& endOffset, uint32_t& badOffset)
+{
+  uint32_t base = journalSectorAddress(sector);
+  uint32_t offset = sizeof(JournalSectorHeader);
+  size_t docLength = 0;
+  bool haveBase = false;
+  badOffset = 0;
+  while (offset < limit && offset + sizeof(JournalRecordHeader) <= SPI_FLASH_SEC_SIZE) {
+    JournalRecordHeader header;
+    if (!ESP.flashRead(base + offset, (uint32_t*)&header, sizeof(header))) {
+      offset = SPI_FLASH_SEC_SIZE;
+      break;
+    }
+    const uint32_t* words = (const uint32_t*)&header;
+    bool erased = true;
+    for (size_t i = 0; i < sizeof(header) / sizeof(uint32_t); i++) {
+      if (words[i] != 0xFFFFFFFF) erased = false;
+    }
+    if (erased) break;
+    if (header.magic != JOURNAL_RECORD_MAGIC || header.length >= (uint32_t)EEPROM_SIZE ||
+        offset + journalRecordSize(header.length) > SPI_FLASH_SEC_SIZE) {
+      offset = SPI_FLASH_SEC_SIZE;
+      break;
+    }
+    if (header.type == JOURNAL_RECORD_SNAPSHOT || haveBase) {
+      JournalApplyResult result = applyJournalRecord(base + offset, header, docLength);
+      if (result == JOURNAL_INCONSISTENT) {
+        badOffset = offset;
+        return false;
+      }
+      if (result == JOURNAL_APPLIED) {
+        haveBase = true;
+        configGeneration = header.generation;
+        journalFlags = header.flags;
+      }
+    }
+    offset += journalRecordSize(header.length);
+  }
+  endOffset = offset;
+  return haveBase;
+}
+
+// scanJournalSector(int sector, uint32_t& endOffset)
+// Rebuilds the newest valid document of one journal sector into currentConfig.
+// - If a record turns out inconsistent, replays again up to the record before it and closes the sector,
+//   so the next save compacts into a fresh sector with a full snapshot.
+// Returns true if a valid document was found.
+
+bool scanJournalSector(int sector, uint32_t& endOffset)
+{
+  uint32_t badOffset;
+  if (replayJournalSector(sector, SPI_FLASH_SEC_SIZE, endOffset, badOffset)) {
+    return true;
+  }
+  if (badOffset == 0) {
+    return false;
+  }
+  Serial.printf("Journal sector %d: inconsistent record at %u; using the state before it.\n", sector, (unsigned)badOffset);
+  bool found = replayJournalSector(sector, badOffset, endOffset, badOffset);
+  endOffset = SPI_FLASH_SEC_SIZE;
+  return found;
+}
+
+// startJournalSector(int sector)
+// Erases a journal sector and writes a fresh header with the next sequence number.
+// - Increments the sector's erase count; the count restarts from zero if the old header was unreadable.
+// - On success the sector becomes journalSector with an empty log.
+
+bool startJournalSector(int sector)
+{
+  JournalSectorHeader header;
+  header.magic = JOURNAL_SECTOR_MAGIC;
+  header.sequence = journalSequence + 1;
+  header.eraseCount = journalEraseCounts[sector] + 1;
+  header.crc = configCrc32(&header, offsetof(JournalSectorHeader, crc));
+
+  uint32_t address = journalSectorAddress(sector);
+  if (!ESP.flashEraseSector(address / SPI_FLASH_SEC_SIZE)) {
+    return false;
+  }
+  journalEraseCounts[sector] = header.eraseCount;
+  if (!ESP.flashWrite(address, (uint32_t*)&header, sizeof(header))) {
+    return false;
+  }
+  journalSector = sector;
+  journalSequence = header.sequence;
+  journalOffset = sizeof(JournalSectorHeader);
+  return true;
+}
+
+// bootModeFlags(const char* mode)
+// Returns the journal flags for a boot mode as DeviceConfig holds it: "CONFIG" boots into CONFIG, anything else
+// into RUN, the same test initWiFi() applies.
+
+uint8_t bootModeFlags(const char* mode)
+{
+  return JOURNAL_FLAG_BOOT_MODE | (strcmp(mode, "CONFIG") == 0 ? JOURNAL_FLAG_CONFIG_MODE : 0);
+}
+
+// storedBootMode()
+// Returns the boot mode ("RUN" or "CONFIG") from the header flags of the newest journal record, or nullptr if
+// that record predates the flag.
+
+const char* storedBootMode()
+{
+  if (!(journalFlags & JOURNAL_FLAG_BOOT_MODE)) return nullptr;
+  return journalFlags & JOURNAL_FLAG_CONFIG_MODE ? "CONFIG" : "RUN";
+}
+
+// appendJournalRecord(const char* newConfig, size_t newLength, uint32_t docCrc, uint8_t flags)
+// Appends one record to the journal that turns the stored document (currentConfig) into newConfig.
+// - Writes a patch covering only the dirty range: the bytes between the common prefix and common suffix.
+// - Compacts into the next sector (round-robin, so the oldest one) when the record does not fit, and
+//   always starts a sector with a full snapshot. Older sectors keep their records until they are reused,
+//   so an interrupted save falls back to them.
+// - Writes the header first so a torn payload can be skipped by its length at the next boot.
+// - Stores flags (the boot mode, see bootModeFlags()) in the header. A mode toggle is therefore a header plus the
+//   few changed bytes of the configMode value.
+// Returns true once the record is fully written.
+
+bool appendJournalRecord(const char* newConfig, size_t newLength, uint32_t docCrc, uint8_t flags)
+{
+  size_t oldLength = strlen(currentConfig);
+  size_t prefix = 0;
+  while (prefix < oldLength && prefix < newLength && currentConfig[prefix] == newConfig[prefix]) {
+    prefix++;
+  }
+  size_t suffix = 0;
+  while (suffix < oldLength - prefix && suffix < newLength - prefix &&
+         currentConfig[oldLength - 1 - suffix] == newConfig[newLength - 1 - suffix]) {
+    suffix++;
+  }
+
+  JournalRecordHeader header;
+  header.magic = JOURNAL_RECORD_MAGIC;
+  header.generation = configGeneration + 1;
+  header.type = JOURNAL_RECORD_PATCH;
+  header.flags = flags;
+  header.offset = prefix;
+  header.removed = oldLength - prefix - suffix;
+  header.length = newLength - prefix - suffix;
+  header.docCrc = docCrc;
+
+  if (journalSector < 0 || journalOffset + journalRecordSize(header.length) > SPI_FLASH_SEC_SIZE) {
+    int next = (journalSector + 1) % CONFIG_JOURNAL_SECTORS;
+    if (!startJournalSector(next)) {
+      return false;
+    }
+    header.type = JOURNAL_RECORD_SNAPSHOT;
+    header.offset = 0;
+    header.removed = 0;
+    header.length = newLength;
+  }
+  const char* payload = newConfig + header.offset;
+  header.crc = configCrc32(payload, header.length, journalHeaderChecksum(header));
+
+  uint32_t address = journalSectorAddress(journalSector) + journalOffset;
+  journalOffset += journalRecordSize(header.length);
+  if (!ESP.flashWrite(address, (uint32_t*)&header, sizeof(header))) {
+    return false;
+  }
+  uint32_t chunk[64];
+  for (uint32_t pos = 0; pos < header.length; pos += sizeof(chunk)) {
+    size_t n = min((size_t)(header.length - pos), sizeof(chunk));
+    memset(chunk, 0, sizeof(chunk));
+    memcpy(chunk, payload + pos, n);
+    if (!ESP.flashWrite(address + sizeof(JournalRecordHeader) + pos, chunk, (n + 3) & ~3u)) {
+      return false;
+    }
+  }
+  configGeneration = header.generation;
+  journalFlags = header.flags;
+  configBytesWritten += journalRecordSize(header.length);
+  return true;
+}
+
+// importLegacyConfig()
+// Copies a config written by the old single-region EEPROM layout into currentConfig.
+// - Only used when the journal holds no valid record (first boot after an upgrade).
+// - Returns false if the EEPROM region is erased or does not hold a JSON object.
+
+bool importLegacyConfig()
+{
+  EEPROM.begin(EEPROM_SIZE);
+  const uint8_t* data = EEPROM.getConstDataPtr();
+  size_t len = strnlen((const char*)data, EEPROM_SIZE - 1);
+  bool valid = len > 0 && data[0] == '{';
+  if (valid) {
+    memcpy(currentConfig, data, len);
+    currentConfig[len] = 0;
+  }
+  EEPROM.end();
+  return valid;
+}
+
 // loadConfigFromEEPROM()
-// Loads the JSON config from EEPROM into currentConfig buffer.
-// - Reads bytes until null terminator or EEPROM_SIZE.
-// - If EEPROM is all 0xFF (empty) or invalid (not starting with '{'), applies defaultConfigJson and saves it.
-// - Prints loaded or default config to Serial.
+// Rebuilds the latest JSON config from the config journal into currentConfig buffer.
+// - Reads the sector headers and replays the sector with the highest sequence.
+// - If that sector holds no valid record, falls back to the next older sector; the next save then compacts
+//   into a fresh sector.
+// - If no record is valid, imports a legacy EEPROM config, or applies defaultConfigJson, and saves it.
+// - Prints loaded or default config and the sector erase counts to Serial (unless configQuiet is set).
 // Call this in initConfig().
 
 void loadConfigFromEEPROM() 
 {
-  EEPROM.begin(EEPROM_SIZE);
-  int i = 0;
-  bool allFF = true;
-  for (; i < EEPROM_SIZE - 1; i++) {
-    char c = EEPROM.read(i);
-    currentConfig[i] = c;
-    if (c != 0xFF) allFF = false;
-    if (c == 0) break;
-  }
-  currentConfig[i] = 0;
-  if (allFF || i == 0 || currentConfig[0] != '{') {
+  JournalSectorHeader headers[CONFIG_JOURNAL_SECTORS];
+  bool valid[CONFIG_JOURNAL_SECTORS];
+  journalSector = -1;
+  journalSequence = 0;
+  journalFlags = 0;
+  for (int sector = 0; sector < CONFIG_JOURNAL_SECTORS; sector++) {
+    valid[sector] = configJournalAvailable() && readJournalSectorHeader(sector, headers[sector]);
+    journalEraseCounts[sector] = valid[sector] ? headers[sector].eraseCount : 0;
+    if (valid[sector] && headers[sector].sequence > journalSequence) {
+      journalSequence = headers[sector].sequence;
+    }
+  }
+
+  for (int attempt = 0; attempt < CONFIG_JOURNAL_SECTORS; attempt++) {
+    int newest = -1;
+    for (int sector = 0; sector < CONFIG_JOURNAL_SECTORS; sector++) {
+      if (valid[sector] && (newest < 0 || headers[sector].sequence > headers[newest].sequence)) {
+        newest = sector;
+      }
+    }
+    if (newest < 0) break;
+    uint32_t endOffset;
+    if (scanJournalSector(newest, endOffset)) {
+      journalSector = newest;
+      journalOffset = attempt == 0 ? endOffset : SPI_FLASH_SEC_SIZE;
+      if (!configQuiet) {
+        Serial.printf("Loaded config from journal sector %d (generation %u):\n", newest, (unsigned)configGeneration);
+        Serial.println(currentConfig);
+      }
+      break;
+    }
+    Serial.printf("Journal sector %d holds no valid record; trying older sector.\n", newest);
+    valid[newest] = false;
+  }
+
+  if (!configQuiet) {
+    Serial.print("Journal erase counts:");
+    for (int sector = 0; sector < CONFIG_JOURNAL_SECTORS; sector++) {
+      Serial.printf(" %u", (unsigned)journalEraseCounts[sector]);
+    }
+    Serial.println();
+  }
+  if (journalSector >= 0) return;
+
+  configGeneration = 0;
+  if (importLegacyConfig()) {
+    saveConfigToEEPROM(currentConfig);
+    Serial.println("Migrated legacy EEPROM config to the config journal.");
+  } else {
     strcpy(currentConfig, defaultConfigJson);
     saveConfigToEEPROM(currentConfig);
     Serial.println("EEPROM empty or invalid; applied and saved default config.");
-  } else {
-    Serial.println("Loaded config from EEPROM:");
-    Serial.println(currentConfig);
   }
-  EEPROM.end();
 }
 
-// saveConfigToEEPROM(const char* newConfig)
-// Saves the provided JSON string to EEPROM.
+// saveConfigToEEPROM(const char* newConfig, const char* bootMode)
+// Saves the provided JSON string to the config journal and mirrors it in currentConfig.
 // - Writes characters up to null terminator or EEPROM_SIZE-1.
-// - Commits changes and ends EEPROM session.
-// - Prints confirmation to Serial.
-// Call this whenever config changes (e.g., from web interface or button).
+// - bootMode ("RUN" or "CONFIG", as in DeviceConfig) goes into the record header flags; callers pass the mode
+//   they parsed or set, so the flag and the configMode key never disagree. Without it the mode is taken from
+//   parseConfig() of newConfig.
+// - Compares with the stored image in currentConfig (and flags) and skips the flash write entirely if nothing
+//   changed.
+// - Otherwise appends a record with only the changed byte range (see appendJournalRecord()).
+// - Counts skipped and written saves in configSavesSkipped / configSavesWritten.
+// - Prints confirmation to Serial (unless configQuiet is set).
+// - Returns false if the config could not be written to flash (currentConfig still follows newConfig when
+//   there is no journal at all, so the device keeps working from RAM).
+// Call this whenever config changes (e.g., from web interface or button). newConfig may be currentConfig itself.
+
+bool saveConfigToEEPROM(const char* newConfig, const char* bootMode) {
+  size_t newLength = strnlen(newConfig, EEPROM_SIZE - 1);
+  uint8_t flags = bootModeFlags(bootMode);
+  if (journalSector >= 0 && journalFlags == flags && strlen(currentConfig) == newLength &&
+      memcmp(currentConfig, newConfig, newLength) == 0) {
+    configSavesSkipped++;
+    if (!configQuiet) Serial.println("Config unchanged; skipped flash write.");
+    return true;
+  }
+  if (!configJournalAvailable()) {
+    memmove(currentConfig, newConfig, newLength);
+    currentConfig[newLength] = 0;
+    Serial.println("No flash reserved for the config journal; config not saved.");
+    return false;
+  }
+  if (!appendJournalRecord(newConfig, newLength, configCrc32(newConfig, newLength), flags)) {
+    Serial.println("Failed to write config journal record.");
+    return false;
+  }
+  memmove(currentConfig, newConfig, newLength);
+  currentConfig[newLength] = 0;
+  configSavesWritten++;
+  if (!configQuiet) Serial.printf("Saved config to journal sector %d (generation %u).\n", journalSector, (unsigned)configGeneration);
+  return true;
+}
 
-void saveConfigToEEPROM(const char* newConfig) {
-  EEPROM.begin(EEPROM_SIZE);
-  int len = strlen(newConfig);
-  if (len > EEPROM_SIZE - 1) len = EEPROM_SIZE - 1;
-  for (int i = 0; i < len; i++) {
-    EEPROM.write(i, newConfig[i]);
+bool saveConfigToEEPROM(const char* newConfig) {
+  DeviceConfig cfg = {};
+  parseConfig(newConfig, cfg);
+  return saveConfigToEEPROM(newConfig, cfg.configMode[0] ? cfg.configMode : "RUN");
+}
+
+// formatConfigJournal()
+// Erases every journal sector and writes empty sector headers, keeping the erase counts.
+// Called by performFactoryReset(); the next boot finds no record and applies the default config.
+
+void formatConfigJournal()
+{
+  if (!configJournalAvailable()) return;
+  journalSector = -1;
+  for (int sector = 0; sector < CONFIG_JOURNAL_SECTORS; sector++) {
+    startJournalSector(sector);
   }
-  EEPROM.write(len, 0);
-  EEPROM.commit();
-  EEPROM.end();
-  Serial.println("Saved config to EEPROM.");
 }
 
 // setAPSSID()
@@ -418,36 +1511,50 @@ void setDeviceHostname()
   Serial.println(hostname);
 }
 
-// parseConfig(const char* jsonConfig)
-// Parses the JSON config string and applies settings.
-// - Uses ArduinoJson to deserialize.
-// - Extracts network settings: ssid, password, useDhcp, staticIp, gateway, subnet.
-// - Extracts configMode into mode.
-// - If not DHCP, parses and sets static IP config using WiFi.config().
-// - Falls back to DHCP on invalid IP strings.
-// - Prints actions to Serial.
-// Called after loading config or changes.
+// parseConfig(const char* jsonConfig, DeviceConfig& cfg)
+// Parses the JSON config string into a typed DeviceConfig.
+// - Uses ArduinoJson with a filter that keeps only the network object and configMode: project-specific keys
+//   are syntax-checked while they are skipped, but never stored in the document.
+// - Extracts network settings: ssid, password, useDhcp, staticIp, gateway, subnet, apFallbackSec.
+// - Extracts configMode.
+// - Leaves cfg untouched and returns false if the JSON is invalid.
+// Called once at boot and after each save; handlers read deviceConfig instead of re-parsing.
 
-void parseConfig(const char* jsonConfig)
+bool parseConfig(const char* jsonConfig, DeviceConfig& cfg)
 {
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, jsonConfig);
+  JsonDocument filter(&jsonPool);
+  filter["network"] = true;
+  filter["configMode"] = true;
+  JsonDocument doc(&jsonPool);
+  DeserializationError error = deserializeJson(doc, jsonConfig, DeserializationOption::Filter(filter));
   if (error) {
     Serial.println("Failed to parse config JSON");
-    return;
+    return false;
   }
   JsonObject netObj = doc["network"];
-  strlcpy(ssid, netObj["ssid"] | "", sizeof(ssid));
-  strlcpy(password, netObj["password"] | "", sizeof(password));
-  bool useDhcp = netObj["useDhcp"] | true;
-  const char* staticIpStr = netObj["staticIp"] | "";
-  const char* gatewayStr = netObj["gateway"] | "";
-  const char* subnetStr = netObj["subnet"] | "";
-  strlcpy(mode, doc["configMode"] | "RUN", sizeof(mode));
+  strlcpy(cfg.ssid, netObj["ssid"] | "", sizeof(cfg.ssid));
+  strlcpy(cfg.password, netObj["password"] | "", sizeof(cfg.password));
+  cfg.useDhcp = netObj["useDhcp"] | true;
+  strlcpy(cfg.staticIp, netObj["staticIp"] | "", sizeof(cfg.staticIp));
+  strlcpy(cfg.gateway, netObj["gateway"] | "", sizeof(cfg.gateway));
+  strlcpy(cfg.subnet, netObj["subnet"] | "", sizeof(cfg.subnet));
+  cfg.apFallbackSec = netObj["apFallbackSec"] | 0;
+  strlcpy(cfg.configMode, doc["configMode"] | "RUN", sizeof(cfg.configMode));
+  return true;
+}
 
+// applyNetworkConfig()
+// Applies the IP settings from deviceConfig.
+// - If not DHCP, parses and sets static IP config using WiFi.config().
+// - Falls back to DHCP on invalid IP strings.
+// - Prints actions to Serial.
+// Called after parseConfig() at boot and when network settings change.
+
+void applyNetworkConfig()
+{
   IPAddress ip, gw, sn;
-  if (!useDhcp) {
-    if (ip.fromString(staticIpStr) && gw.fromString(gatewayStr) && sn.fromString(subnetStr)) {
+  if (!deviceConfig.useDhcp) {
+    if (ip.fromString(deviceConfig.staticIp) && gw.fromString(deviceConfig.gateway) && sn.fromString(deviceConfig.subnet)) {
       WiFi.config(ip, gw, sn);
       char ipBuf[16];
       snprintf(ipBuf, sizeof(ipBuf), "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
@@ -462,15 +1569,133 @@ void parseConfig(const char* jsonConfig)
   }
 }
 
+// mergeDeviceConfig(const char* json, const DeviceConfig& cfg, char* out, size_t size)
+// Writes json with the values of cfg merged in to out.
+// - Keeps the other keys of json, so project-specific settings survive.
+// - Overwrites the network settings and configMode with the values in cfg.
+// - Returns false if json cannot be parsed or the result does not fit in size.
+// The JSON mutation of persistConfig(), on its own so /bench can time it without writing flash.
+
+bool mergeDeviceConfig(const char* json, const DeviceConfig& cfg, char* out, size_t size)
+{
+  JsonDocument doc(&jsonPool);
+  DeserializationError error = deserializeJson(doc, json);
+  if (error) {
+    Serial.print("JSON parse error while saving config: ");
+    Serial.println(error.c_str());
+    return false;
+  }
+  JsonObject netObj = doc["network"];
+  if (netObj.isNull()) {
+    netObj = doc["network"].to<JsonObject>();
+  }
+  netObj["ssid"] = cfg.ssid;
+  netObj["password"] = cfg.password;
+  netObj["useDhcp"] = cfg.useDhcp;
+  netObj["staticIp"] = cfg.staticIp;
+  netObj["gateway"] = cfg.gateway;
+  netObj["subnet"] = cfg.subnet;
+  netObj["apFallbackSec"] = cfg.apFallbackSec;
+  doc["configMode"] = cfg.configMode;
+  if (measureJson(doc) >= size) {
+    Serial.println("Config too large; not saved");
+    return false;
+  }
+  serializeJson(doc, out, size);
+  return true;
+}
+
+// persistConfig(const DeviceConfig& cfg)
+// Rebuilds the JSON from cfg, saves it to EEPROM (which also updates currentConfig) and then makes cfg the
+// live deviceConfig.
+// - mergeDeviceConfig() rebuilds it from the stored JSON, so project-specific keys are kept.
+// - Serializes into the scratch arena (ScratchBuffer), not a stack buffer.
+// - Returns false if the stored JSON cannot be parsed, the result does not fit or the flash write fails;
+//   deviceConfig is left unchanged then, so RAM never runs on settings that are not stored.
+// This is the only place the JSON text is regenerated; fill a copy of deviceConfig and pass it here.
+
+bool persistConfig(const DeviceConfig& cfg)
+{
+  ScratchBuffer newJson;
+  if (!newJson.data) {
+    Serial.println("Scratch buffer busy; config not saved");
+    return false;
+  }
+  if (!mergeDeviceConfig(currentConfig, cfg, newJson.data, newJson.size) ||
+      !saveConfigToEEPROM(newJson.data, cfg.configMode)) {
+    return false;
+  }
+  deviceConfig = cfg;
+  storeRtcConfigCache();
+  checkStackHighWater("persistConfig");
+  return true;
+}
+
+// persistConfigMode(const char* mode)
+// Saves mode ("RUN" or "CONFIG") as configMode by splicing it into the stored JSON, without parsing the document,
+// and sets deviceConfig.configMode once it is stored.
+// - findJsonMember() locates the top-level configMode string; the rest of the text is copied unchanged into the
+//   scratch arena, so the journal records only the few changed bytes.
+// - Falls back to persistConfig() if the stored config has no configMode string.
+// - Returns false, with deviceConfig unchanged, if the config could not be saved.
+// Used by the mode toggles (button, /restart), which change nothing else.
+
+bool persistConfigMode(const char* mode)
+{
+  DeviceConfig newConfig = deviceConfig;
+  strlcpy(newConfig.configMode, mode, sizeof(newConfig.configMode));
+  size_t length;
+  const char* value = findJsonMember(currentConfig, "configMode", &length);
+  if (!value || *value != '"') {
+    return persistConfig(newConfig);
+  }
+  ScratchBuffer newJson;
+  if (!newJson.data) {
+    return false;
+  }
+  int written = snprintf(newJson.data, newJson.size, "%.*s\"%s\"%s",
+                         (int)(value - currentConfig), currentConfig, newConfig.configMode, value + length);
+  if (written < 0 || (size_t)written >= newJson.size || !saveConfigToEEPROM(newJson.data, newConfig.configMode)) {
+    return false;
+  }
+  deviceConfig = newConfig;
+  storeRtcConfigCache();
+  checkStackHighWater("persistConfigMode");
+  return true;
+}
+
+// applyConfigJson(const char* newJson)
+// Saves a complete new JSON config and puts it into effect: deviceConfig, IP settings and the RTC cache.
+// - Parses it first; returns false without writing anything if it is not valid JSON.
+// - Returns false, with deviceConfig unchanged, if the flash write fails.
+// Used by the JSON editor and /api/config, which replace the document as a whole.
+
+bool applyConfigJson(const char* newJson)
+{
+  DeviceConfig newConfig = deviceConfig;
+  if (!parseConfig(newJson, newConfig) || !saveConfigToEEPROM(newJson, newConfig.configMode)) {
+    return false;
+  }
+  deviceConfig = newConfig;
+  applyNetworkConfig();
+  storeRtcConfigCache();
+  checkStackHighWater("applyConfigJson");
+  return true;
+}
+
 // performFactoryReset()
-// Resets EEPROM to all 0xFF (erased state).
-// - Writes 0xFF to all bytes in EEPROM_SIZE.
+// Resets EEPROM and the config journal to the erased state.
+// - Invalidates the RTC config cache so the restart does not restore the old config.
+// - Formats the config journal (erase counts are kept).
+// - Writes 0xFF to all bytes in EEPROM_SIZE so no legacy config or WiFi connect cache survives.
 // - Commits and ends EEPROM.
 // - Prints to Serial and restarts ESP.
 // Called on long button press or from web interface.
 
 void performFactoryReset() 
 {
+  invalidateRtcConfigCache();
+  formatConfigJournal();
   EEPROM.begin(EEPROM_SIZE);
   for (int i = 0; i < EEPROM_SIZE; i++) {
     EEPROM.write(i, 0xFF);
@@ -494,7 +1719,7 @@ void performFactoryReset()
 // handleRoot()
 // Handles GET/POST to root "/".
 // - In CONFIG: Redirects to /network.
-// - In RUN: Shows basic home page.
+// - In RUN: Shows basic home page (304 if the browser's copy is from this firmware).
 // Extend this for your project's dashboard.
 
 void handleRoot() {
@@ -503,63 +1728,66 @@ void handleRoot() {
     server.send(303);
     return;
   }
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
+  char etag[20];
+  pageETag(etag, sizeof(etag), nullptr);
+  if (sendNotModifiedIfCurrent(etag, "no-cache")) return;
+  beginHtmlResponse();
   sendHtmlHeader("Home");
-  server.sendContent(F("<h1>ESP01 Web Manager</h1>"));
+  sendHtml(F("<h1>ESP01 Web Manager</h1>"));
   sendHtmlFooter();
-  server.sendContent("");
+  endHtmlResponse();
 }
 
 // handleRestart()
 // Handles GET/POST to /restart.
-// - GET: Shows form with radio options: Reboot, to RUN, to CONFIG.
-// - POST: Processes action, updates configMode if needed, saves, restarts.
+// - GET: Shows form with radio options: Reboot, to RUN, to CONFIG, and to RUN/CONFIG once (304 if unchanged).
+// - POST: Processes action, updates deviceConfig.configMode if needed, saves it (persistConfigMode()), restarts.
+//   If the mode cannot be saved, answers 500 and stays up, so the device does not come back in the old mode.
+//   The "once" actions only store a restart intent in RTC memory (storeRestartIntent()) and leave flash alone.
 
 void handleRestart() {
   if (server.method() == HTTP_POST) {
     String action = server.arg("action");
-    bool needSave = false;
-    StaticJsonDocument<512> doc;
-    DeserializationError error = deserializeJson(doc, currentConfig);
-    if (!error) {
-      const char* currentMode = doc["configMode"] | "RUN";
-      if (action == "run" && strcmp(currentMode, "RUN") != 0) {
-        doc["configMode"] = "RUN";
-        needSave = true;
-      } else if (action == "config" && strcmp(currentMode, "CONFIG") != 0) {
-        doc["configMode"] = "CONFIG";
-        needSave = true;
-      }
-      if (needSave) {
-        char newJson[EEPROM_SIZE];
-        serializeJson(doc, newJson, sizeof(newJson));
-        saveConfigToEEPROM(newJson);
-        strcpy(currentConfig, newJson);
-      }
+    const char* newMode = nullptr;
+    if (action == "run" && strcmp(deviceConfig.configMode, "RUN") != 0) {
+      newMode = "RUN";
+    } else if (action == "config" && strcmp(deviceConfig.configMode, "CONFIG") != 0) {
+      newMode = "CONFIG";
+    } else if (action == "run-once") {
+      storeRestartIntent("RUN");
+    } else if (action == "config-once") {
+      storeRestartIntent("CONFIG");
+    }
+    if (newMode && !persistConfigMode(newMode)) {
+      server.send(500, "text/html", "<p>Could not save the new mode; not restarting.</p><p><a href='/restart'>Back</a></p>");
+      return;
     }
     server.send(200, "text/html", "<p>Restarting...</p>");
     delay(500);
-    ESP.restart();
+    restartDevice();
     return;
   }
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
+  char etag[20];
+  pageETag(etag, sizeof(etag), nullptr);
+  if (sendNotModifiedIfCurrent(etag, "no-cache")) return;
+  beginHtmlResponse();
   sendHtmlHeader("Restart");
-  server.sendContent(F("<h1>Restart ESP</h1>"
-                       "<form method='POST'>"
-                       "<label><input type='radio' name='action' value='reboot' checked> Reboot</label><br>"
-                       "<label><input type='radio' name='action' value='run'> Reboot to RUN</label><br>"
-                       "<label><input type='radio' name='action' value='config'> Reboot to Config</label><br>"
-                       "<input type='submit' value='Execute'>"
-                       "</form>"));
+  sendHtml(F("<h1>Restart ESP</h1>"
+             "<form method='POST'>"
+             "<label><input type='radio' name='action' value='reboot' checked> Reboot</label><br>"
+             "<label><input type='radio' name='action' value='run'> Reboot to RUN</label><br>"
+             "<label><input type='radio' name='action' value='config'> Reboot to Config</label><br>"
+             "<label><input type='radio' name='action' value='run-once'> Reboot to RUN once</label><br>"
+             "<label><input type='radio' name='action' value='config-once'> Reboot to Config once</label><br>"
+             "<input type='submit' value='Execute'>"
+             "</form>"));
   sendHtmlFooter();
-  server.sendContent("");
+  endHtmlResponse();
 }
 
 // handleFactoryReset()
 // Handles GET/POST to /factoryreset.
-// - GET: Shows confirmation form.
+// - GET: Shows confirmation form (304 if unchanged).
 // - POST: Calls performFactoryReset().
 
 void handleFactoryReset() {
@@ -567,198 +1795,554 @@ void handleFactoryReset() {
     performFactoryReset();
     return;
   }
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
+  char etag[20];
+  pageETag(etag, sizeof(etag), nullptr);
+  if (sendNotModifiedIfCurrent(etag, "no-cache")) return;
+  beginHtmlResponse();
   sendHtmlHeader("Factory Reset");
-  server.sendContent(F("<h1>Reset to Factory</h1>"
-                       "<form method='POST' onsubmit='return confirm(\"Are you sure?\");'>"
-                       "<input type='submit' value='Reset to Factory'></form>"));
+  sendHtml(F("<h1>Reset to Factory</h1>"
+             "<form method='POST' onsubmit='return confirm(\"Are you sure?\");'>"
+             "<input type='submit' value='Reset to Factory'></form>"));
   sendHtmlFooter();
-  server.sendContent("");
+  endHtmlResponse();
 }
 
 // handleJsonEditor()
 // Handles GET/POST to /jsonedit.
-// - GET: Shows textarea with currentConfig for editing.
-// - POST: Saves new JSON from form, updates currentConfig, parses, redirects.
+// - GET: Shows textarea with currentConfig for editing; the ETag hashes currentConfig, so unchanged config gets a 304.
+// - POST: The jsondata form field is URL-decoded in place in the request body (server.formField()), validated and
+//   stripped of whitespace there (compactJson()) and saved from that buffer by applyConfigJson(), then redirects.
+//   The body is the only buffer the document ever occupies. Invalid JSON, a non-object or a document larger than
+//   EEPROM_SIZE is refused with 400 before anything is written.
 
 void handleJsonEditor() {
   if (server.method() == HTTP_POST) {
-    if (server.hasArg("jsondata")) {
-      char newConfig[EEPROM_SIZE];
-      server.arg("jsondata").toCharArray(newConfig, EEPROM_SIZE);
-      saveConfigToEEPROM(newConfig);
-      strcpy(currentConfig, newConfig);
-      parseConfig(currentConfig);
+#ifdef WEB_SERVER_LEGACY
+    String jsondata = server.arg("jsondata");
+    char* json = jsondata.begin();
+#else
+    char* json = server.formField("jsondata");
+#endif
+    size_t length = json ? compactJson(json, JSON_MAX_DEPTH) : 0;
+    if (length == 0 || *json != '{' || length >= EEPROM_SIZE) {
+      server.send(400, "text/html", "Invalid JSON, config not saved");
+      return;
+    }
+    if (!applyConfigJson(json)) {
+      server.send(400, "text/html", "Invalid config, not saved");
+      return;
     }
     server.sendHeader("Location", "/jsonedit");
     server.send(303);
     return;
   }
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
+  char etag[20];
+  pageETag(etag, sizeof(etag), currentConfig);
+  if (sendNotModifiedIfCurrent(etag, "no-cache")) return;
+  beginHtmlResponse();
   sendHtmlHeader("JSON Editor");
-  server.sendContent(F("<h1>JSON Editor</h1>"
-                       "<form method='POST' action='/jsonedit'>"
-                       "<textarea name='jsondata' rows='15' cols='50'>"));
-  server.sendContent(currentConfig);
-  server.sendContent(F("</textarea><br>"
-                       "<input type='submit' value='Save'>"
-                       "</form>"));
+  sendHtml(F("<h1>JSON Editor</h1>"
+             "<form method='POST' action='/jsonedit'>"
+             "<textarea name='jsondata' rows='15' cols='50'>"));
+  sendHtml(currentConfig);
+  sendHtml(F("</textarea><br>"
+             "<input type='submit' value='Save'>"
+             "</form>"));
   sendHtmlFooter();
-  server.sendContent("");
+  endHtmlResponse();
 }
 
 // handleNetworkConfig()
 // Handles GET/POST to /network.
-// - GET: Parses current config, shows form with current values for SSID, password, DHCP/static, IPs.
-// - POST: Updates network section in JSON, saves, parses, redirects.
+// - GET: Shows form with current values for SSID, password, DHCP/static, IPs, AP fallback from deviceConfig.
+//   The ETag hashes currentConfig, so unchanged config gets a 304.
+// - POST: Fills a copy of deviceConfig from the form and persists it (persistConfig() makes it live only once
+//   it is saved), applies IP settings, redirects. A failed save answers 500 and leaves deviceConfig as it was.
 // Use this to configure WiFi settings via web.
 
 void handleNetworkConfig() {
   if (server.method() == HTTP_POST) {
-    char newSsid[32];
-    char newPassword[64];
-    bool useDhcpBool = server.arg("useDhcp") == "1";
-    char staticIp[16];
-    char gateway[16];
-    char subnet[16];
-    server.arg("ssid").toCharArray(newSsid, sizeof(newSsid));
-    server.arg("password").toCharArray(newPassword, sizeof(newPassword));
-    server.arg("staticIp").toCharArray(staticIp, sizeof(staticIp));
-    server.arg("gateway").toCharArray(gateway, sizeof(gateway));
-    server.arg("subnet").toCharArray(subnet, sizeof(subnet));
-
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, currentConfig);
-    if (error) {
-      Serial.println("Failed to parse config JSON");
+    DeviceConfig newConfig = deviceConfig;
+    server.arg("ssid").toCharArray(newConfig.ssid, sizeof(newConfig.ssid));
+    server.arg("password").toCharArray(newConfig.password, sizeof(newConfig.password));
+    newConfig.useDhcp = server.arg("useDhcp") == "1";
+    server.arg("staticIp").toCharArray(newConfig.staticIp, sizeof(newConfig.staticIp));
+    server.arg("gateway").toCharArray(newConfig.gateway, sizeof(newConfig.gateway));
+    server.arg("subnet").toCharArray(newConfig.subnet, sizeof(newConfig.subnet));
+    if (server.hasArg("apFallbackSec")) {
+      newConfig.apFallbackSec = server.arg("apFallbackSec").toInt();
+    }
+
+    if (!persistConfig(newConfig)) {
       server.send(500, "text/html", "Error parsing config");
       return;
     }
-    JsonObject netObj = doc["network"];
-    netObj["ssid"] = newSsid;
-    netObj["password"] = newPassword;
-    netObj["useDhcp"] = useDhcpBool;
-    netObj["staticIp"] = staticIp;
-    netObj["gateway"] = gateway;
-    netObj["subnet"] = subnet;
-    serializeJson(doc, currentConfig, sizeof(currentConfig));
-    saveConfigToEEPROM(currentConfig);
-    parseConfig(currentConfig);
+    applyNetworkConfig();
     server.sendHeader("Location", "/network");
     server.send(303);
     return;
   }
 
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, currentConfig);
-  if (error) {
-    Serial.println("Failed to parse config JSON");
-    server.send(500, "text/html", "Error parsing config");
-    return;
-  }
-  JsonObject netObj = doc["network"];
-  char currSsid[32];
-  char currPassword[64];
-  bool currUseDhcp = netObj["useDhcp"] | true;
-  char currStaticIp[16];
-  char currGateway[16];
-  char currSubnet[16];
-  strlcpy(currSsid, netObj["ssid"] | "a", sizeof(currSsid));
-  strlcpy(currPassword, netObj["password"] | "", sizeof(currPassword));
-  strlcpy(currStaticIp, netObj["staticIp"] | "", sizeof(currStaticIp));
-  strlcpy(currGateway, netObj["gateway"] | "", sizeof(currGateway));
-  strlcpy(currSubnet, netObj["subnet"] | "", sizeof(currSubnet));
-
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
+  const char* currSsid = deviceConfig.ssid;
+  const char* currPassword = deviceConfig.password;
+  bool currUseDhcp = deviceConfig.useDhcp;
+  const char* currStaticIp = deviceConfig.staticIp;
+  const char* currGateway = deviceConfig.gateway;
+  const char* currSubnet = deviceConfig.subnet;
+
+  char etag[20];
+  pageETag(etag, sizeof(etag), currentConfig);
+  if (sendNotModifiedIfCurrent(etag, "no-cache")) return;
+  beginHtmlResponse();
   sendHtmlHeader("Network Config");
-  server.sendContent(F("<h1>Network Config</h1>"
-                       "<form method='POST' action='/network'>"
-                       "<table>"
-                       "<tr><th>SSID</th><td>"));
-  char buf[256];
-  snprintf(buf, sizeof(buf), "<input type='text' name='ssid' value='%s'>", currSsid);
-  server.sendContent(buf);
-  server.sendContent(F("</td></tr>"
-                       "<tr><th>Password</th><td>"));
-  snprintf(buf, sizeof(buf), "<input type='text' name='password' value='%s'>", currPassword);
-  server.sendContent(buf);
-  server.sendContent(F("</td></tr>"
-                       "<tr><th>IP Settings</th><td>"));
+  sendHtml(F("<h1>Network Config</h1>"
+             "<form method='POST' action='/network'>"
+             "<table>"
+             "<tr><th>SSID</th><td>"));
+  sendHtmlf("<input type='text' name='ssid' value='%s'>", currSsid);
+  sendHtml(F("</td></tr>"
+             "<tr><th>Password</th><td>"));
+  sendHtmlf("<input type='text' name='password' value='%s'>", currPassword);
+  sendHtml(F("</td></tr>"
+             "<tr><th>IP Settings</th><td>"));
   const char* dhcpChecked = currUseDhcp ? " checked='checked'" : "";
   const char* staticChecked = !currUseDhcp ? " checked='checked'" : "";
-  snprintf(buf, sizeof(buf), "<input type='radio' name='useDhcp' value='1'%s> DHCP "
-                             "<input type='radio' name='useDhcp' value='0'%s> Static", dhcpChecked, staticChecked);
-  server.sendContent(buf);
-  server.sendContent(F("</td></tr>"
-                       "<tr><th>Static IP</th><td>"));
-  snprintf(buf, sizeof(buf), "<input type='text' name='staticIp' value='%s'>", currStaticIp);
-  server.sendContent(buf);
-  server.sendContent(F("</td></tr>"
-                       "<tr><th>Gateway</th><td>"));
-  snprintf(buf, sizeof(buf), "<input type='text' name='gateway' value='%s'>", currGateway);
-  server.sendContent(buf);
-  server.sendContent(F("</td></tr>"
-                       "<tr><th>Subnet</th><td>"));
-  snprintf(buf, sizeof(buf), "<input type='text' name='subnet' value='%s'>", currSubnet);
-  server.sendContent(buf);
-  server.sendContent(F("</td></tr>"
-                       "</table>"
-                       "<br><input type='submit' value='Save'>"
-                       "</form>"));
+  sendHtmlf("<input type='radio' name='useDhcp' value='1'%s> DHCP "
+            "<input type='radio' name='useDhcp' value='0'%s> Static", dhcpChecked, staticChecked);
+  sendHtml(F("</td></tr>"
+             "<tr><th>Static IP</th><td>"));
+  sendHtmlf("<input type='text' name='staticIp' value='%s'>", currStaticIp);
+  sendHtml(F("</td></tr>"
+             "<tr><th>Gateway</th><td>"));
+  sendHtmlf("<input type='text' name='gateway' value='%s'>", currGateway);
+  sendHtml(F("</td></tr>"
+             "<tr><th>Subnet</th><td>"));
+  sendHtmlf("<input type='text' name='subnet' value='%s'>", currSubnet);
+  sendHtml(F("</td></tr>"
+             "<tr><th>AP Fallback (s)</th><td>"));
+  sendHtmlf("<input type='text' name='apFallbackSec' value='%u'>", (unsigned)deviceConfig.apFallbackSec);
+  sendHtml(F("</td></tr>"
+             "</table>"
+             "<br><input type='submit' value='Save'>"
+             "</form>"));
   sendHtmlFooter();
-  server.sendContent("");
+  endHtmlResponse();
 
   Serial.print("Heap before sending: ");
   Serial.println(ESP.getFreeHeap());
-  server.client().flush();
 }
 
+// handleStatus()
+// Handles GET to /status.
+// - Shows config storage details: generation, active journal sector, bytes used, written vs skipped saves
+//   and erase count per sector.
+// - Shows WiFi outage statistics from superviseWiFi().
+// - Shows web server connection and keep-alive reuse counters and its buffer budget use (AsyncHttpServer only).
+// - Shows heap and JSON pool usage and fragmentation, and the continuation stack high-water mark.
+// - Shows size, chunk count and send time of the last page rendered before this one.
+// Use this to monitor flash wear and memory; extend it with your own runtime metrics.
+
+void handleStatus() {
+  beginHtmlResponse();
+  sendHtmlHeader("Status");
+  sendHtml(F("<h1>Status</h1>"
+             "<table>"
+             "<tr><th>Config Storage</th><td>"));
+  const char* bootMode = storedBootMode();
+  sendHtmlf("Generation %u, sector %d, %u of %u bytes used, boot mode flag %s",
+            (unsigned)configGeneration, journalSector, (unsigned)journalOffset, (unsigned)SPI_FLASH_SEC_SIZE,
+            bootMode ? bootMode : "not set");
+  sendHtml(F("</td></tr>"
+             "<tr><th>Config Saves</th><td>"));
+  sendHtmlf("%u written (%u bytes), %u skipped as unchanged",
+            (unsigned)configSavesWritten, (unsigned)configBytesWritten, (unsigned)configSavesSkipped);
+  sendHtml(F("</td></tr>"
+             "<tr><th>Erase Counts</th><td>"));
+  for (int sector = 0; sector < CONFIG_JOURNAL_SECTORS; sector++) {
+    sendHtmlf("%s%u", sector ? ", " : "", (unsigned)journalEraseCounts[sector]);
+  }
+  sendHtml(F("</td></tr>"
+             "<tr><th>WiFi Outages</th><td>"));
+  sendHtmlf("%u (last %lu ms, longest %lu ms, total %lu ms)",
+            (unsigned)wifiOutageCount, wifiOutageLastMs, wifiOutageLongestMs, wifiOutageTotalMs);
+#ifndef WEB_SERVER_LEGACY
+  sendHtml(F("</td></tr>"
+             "<tr><th>Web Server</th><td>"));
+  const HttpServerStats& web = server.stats();
+  sendHtmlf("%u active (peak %u), %u accepted, %u refused, %u requests, %u timeouts",
+            (unsigned)server.activeConnections(), (unsigned)web.peakConnections, (unsigned)web.connectionsAccepted,
+            (unsigned)web.connectionsRejected, (unsigned)web.requestsServed, (unsigned)web.timeouts);
+  sendHtmlf("<br>Keep-alive: %u requests on reused connections, %u idle connections evicted",
+            (unsigned)web.connectionReuses, (unsigned)web.idleEvictions);
+  sendHtmlf("<br>Buffers: %u of %u bytes in use (peak %u), %u responses cut",
+            (unsigned)web.bufferedBytes, (unsigned)HTTP_BUFFER_BUDGET, (unsigned)web.peakBufferedBytes,
+            (unsigned)web.responsesCut);
+#endif
+  sendHtml(F("</td></tr>"
+             "<tr><th>Heap</th><td>"));
+  sendHtmlf("%u bytes free, largest block %u, fragmentation %u%%",
+            (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMaxFreeBlockSize(), (unsigned)ESP.getHeapFragmentation());
+  sendHtml(F("</td></tr>"
+             "<tr><th>JSON Pool</th><td>"));
+  const JsonPoolStats& pool = jsonPool.stats();
+  sendHtmlf("%u of %u bytes in use (peak %u), largest free %u, fragmentation %u%%, %u allocations, %u heap fallbacks",
+            (unsigned)pool.used, (unsigned)jsonPool.size(), (unsigned)pool.peakUsed, (unsigned)jsonPool.largestFreeBlock(),
+            (unsigned)jsonPool.fragmentation(), (unsigned)pool.allocations, (unsigned)pool.heapFallbacks);
+  sendHtml(F("</td></tr>"
+             "<tr><th>Stack</th><td>"));
+  checkStackHighWater("handleStatus");
+  sendHtmlf("%u bytes free at the deepest point (%s)", (unsigned)stackLowestFree, stackLowestWhere);
+  sendHtml(F("</td></tr>"
+             "<tr><th>Last Page</th><td>"));
+  sendHtmlf("%s: %u bytes in %u chunks, %lu ms",
+            lastPageUri, (unsigned)lastPageBytes, (unsigned)lastPageChunks, lastPageMs);
+  sendHtml(F("</td></tr>"
+             "</table>"));
+  sendHtmlFooter();
+  endHtmlResponse();
+}
+
+// sendApiError(int code, const char* message)
+// Sends an /api/ error as {"error": message} with the given status code.
+
+void sendApiError(int code, const char* message)
+{
+  char json[96];
+  snprintf(json, sizeof(json), "{\"error\":\"%s\"}", message);
+  server.send(code, "application/json", json);
+}
+
+// applyMergePatch(JsonObject target, JsonObjectConst patch)
+// Applies a JSON merge patch (RFC 7396) to target.
+// - A null member removes the key; an object member is merged recursively (replacing a non-object value);
+//   any other value, including arrays, replaces the target member.
+
+void applyMergePatch(JsonObject target, JsonObjectConst patch)
+{
+  for (JsonPairConst member : patch) {
+    if (member.value().isNull()) {
+      target.remove(member.key());
+    } else if (member.value().is<JsonObjectConst>()) {
+      auto child = target[member.key()]; // Proxy, so to<JsonObject>() can create a missing member
+      JsonObject childObject = child.is<JsonObject>() ? child.as<JsonObject>() : child.to<JsonObject>();
+      applyMergePatch(childObject, member.value().as<JsonObjectConst>());
+    } else {
+      target[member.key()] = member.value();
+    }
+  }
+}
+
+// handleApiConfig()
+// Handles GET /api/config: returns the stored JSON config with its ETag (304 if the client's copy is current).
+
+void handleApiConfig()
+{
+  char etag[12];
+  configETag(etag, sizeof(etag));
+  if (sendNotModifiedIfCurrent(etag, "no-cache")) return;
+  server.send(200, "application/json", currentConfig);
+}
+
+// handleApiConfigUpdate()
+// Handles PUT and PATCH /api/config.
+// - PUT replaces the whole config with the body; PATCH merges the body into it (RFC 7396).
+// - If-Match: the update is refused with 412 unless it names the current ETag (or "*"), so two tools
+//   editing one device cannot silently overwrite each other. Strong comparison: a W/ tag never matches.
+// - The body must be a JSON object (415 for another Content-Type, 400 if invalid). It is parsed straight from
+//   the request stream, without a String copy (ESP8266WebServer builds fall back to arg("plain")).
+// - The result is validated (size, then applyConfigJson()) before anything is written; 413 if it does not fit
+//   EEPROM_SIZE.
+// - On success the config is saved and applied like a /jsonedit save, and returned with its new ETag.
+
+void handleApiConfigUpdate()
+{
+  char etag[12];
+  configETag(etag, sizeof(etag));
+  if (server.hasHeader("If-Match")) {
+    if (!etagListMatches(server.header("If-Match").c_str(), etag, false)) {
+      server.sendHeader("ETag", etag);
+      sendApiError(412, "config has changed");
+      return;
+    }
+  }
+  if (server.hasHeader("Content-Type") && !server.header("Content-Type").startsWith("application/json")) {
+    sendApiError(415, "expected application/json");
+    return;
+  }
+
+  JsonDocument body(&jsonPool);
+#ifdef WEB_SERVER_LEGACY
+  DeserializationError error = deserializeJson(body, server.arg("plain"));
+#else
+  DeserializationError error = deserializeJson(body, server.body());
+#endif
+  if (error || !body.is<JsonObject>()) {
+    sendApiError(400, error ? error.c_str() : "expected a JSON object");
+    return;
+  }
+
+  JsonDocument merged(&jsonPool);
+  JsonDocument& doc = server.method() == HTTP_PATCH ? merged : body;
+  if (server.method() == HTTP_PATCH) {
+    if (deserializeJson(merged, currentConfig) || !merged.is<JsonObject>()) {
+      merged.to<JsonObject>();
+    }
+    applyMergePatch(merged.as<JsonObject>(), body.as<JsonObjectConst>());
+  }
+
+  if (measureJson(doc) >= EEPROM_SIZE) {
+    sendApiError(413, "config too large");
+    return;
+  }
+  ScratchBuffer newJson;
+  if (!newJson.data) {
+    sendApiError(503, "busy");
+    return;
+  }
+  serializeJson(doc, newJson.data, newJson.size);
+  if (!applyConfigJson(newJson.data)) {
+    sendApiError(400, "invalid config");
+    return;
+  }
+  configETag(etag, sizeof(etag));
+  server.sendHeader("ETag", etag);
+  server.send(200, "application/json", currentConfig);
+}
+
+#ifdef CONFIG_BENCH
+// benchConfig(char* out, size_t size, size_t target)
+// Writes a config of target bytes to out and returns its length: the default document with the values of
+// deviceConfig merged in (so the timed merge does not change its size), plus an "app" object of short string
+// members like a project's own settings.
+// - A target too small to hold any members (0 for instance) gives defaultConfigJson unchanged.
+
+size_t benchConfig(char* out, size_t size, size_t target)
+{
+  if (target >= size) target = size - 1;
+  size_t length = mergeDeviceConfig(defaultConfigJson, deviceConfig, out, size) ? strlen(out) : 0;
+  if (length == 0 || target < length + 32) {
+    strlcpy(out, defaultConfigJson, size);
+    return strlen(out);
+  }
+  length--; // Reopen the top-level object
+  length += snprintf(out + length, size - length, ",\"app\":{");
+  for (int member = 0; ; member++) {
+    size_t left = target - length - 2; // Room before the closing "}}"
+    size_t overhead = member ? 10 : 9;  // ,"k000":""
+    bool last = left < overhead + 32;
+    size_t value = last ? left - overhead : 16;
+    length += snprintf(out + length, size - length, "%s\"k%03d\":\"", member ? "," : "", member);
+    memset(out + length, 'a' + member % 26, value);
+    length += value;
+    out[length++] = '"';
+    if (last) break;
+  }
+  strcpy(out + length, "}}");
+  return length + 2;
+}
+
+// Measurements of one operation at one config size, from benchMeasure().
+struct BenchStat {
+  uint32_t minCycles;
+  uint32_t avgCycles;
+  uint32_t maxCycles;
+  uint32_t allocations;     // JSON pool allocations in one run (the most of any run)
+  uint32_t poolPeak;        // JSON pool bytes held at once in one run, above what was held before it
+  uint32_t heapFallbacks;   // Allocations the pool could not hold, i.e. heap allocations (all runs)
+  int32_t heapDelta;        // Free heap after all runs minus before: nonzero means something was kept
+  uint32_t failures;        // Runs whose operation reported failure
+};
+
+// benchMeasure(int runs, Op op)
+// Runs op (a callable returning false on failure) runs times and returns its cycle counts and memory use.
+// - Cycles come from ESP.getCycleCount() (80 MHz, so it wraps after 53 s; no single run comes close).
+// - The JSON pool peak is restarted before each run, so poolPeak is the high-water mark of that run alone.
+
+template <typename Op>
+BenchStat benchMeasure(int runs, Op op)
+{
+  BenchStat stat = {};
+  stat.minCycles = UINT32_MAX;
+  uint64_t totalCycles = 0;
+  uint32_t freeHeap = ESP.getFreeHeap();
+  for (int run = 0; run < runs; run++) {
+    JsonPoolStats before = jsonPool.stats();
+    jsonPool.resetPeak();
+    uint32_t start = ESP.getCycleCount();
+    bool ok = op();
+    uint32_t cycles = ESP.getCycleCount() - start;
+    const JsonPoolStats& after = jsonPool.stats();
+    totalCycles += cycles;
+    if (cycles < stat.minCycles) stat.minCycles = cycles;
+    if (cycles > stat.maxCycles) stat.maxCycles = cycles;
+    if (after.allocations - before.allocations > stat.allocations) {
+      stat.allocations = after.allocations - before.allocations;
+    }
+    if (after.peakUsed - before.used > stat.poolPeak) stat.poolPeak = after.peakUsed - before.used;
+    stat.heapFallbacks += after.heapFallbacks - before.heapFallbacks;
+    if (!ok) stat.failures++;
+    yield();
+  }
+  stat.avgCycles = totalCycles / runs;
+  stat.heapDelta = (int32_t)ESP.getFreeHeap() - (int32_t)freeHeap;
+  return stat;
+}
+
+// handleBench()
+// Handles GET to /bench (builds with -DCONFIG_BENCH only: env:esp01_bench, env:native).
+// - For each size in benchSizes, saves a generated config (benchConfig()) and then times BENCH_RUNS runs each
+//   of loadConfigFromEEPROM(), parseConfig() and mergeDeviceConfig() (the JSON mutation of a /network save),
+//   and BENCH_SAVES runs of saveConfigToEEPROM() that toggle configMode, as the mode toggles do.
+// - Reports per operation: cycles (min, average, max), the average in µs, JSON pool allocations and peak
+//   bytes per run, heap fallbacks, the free heap change and failed runs. The table also goes to Serial.
+// - Restores the original config afterwards; deviceConfig is never touched.
+// - Blocks the web server for a second or so, and writes about 25 journal records (a sector erase every other
+//   run or so): keep it out of production firmware.
+// On the host (env:native) run "program --get /bench"; cycles are host time scaled to 80 MHz there.
+
+void handleBench() {
+  static const char* const opNames[BENCH_OPS] = { "load", "parse", "mutate", "save" };
+  static BenchStat results[BENCH_SIZE_COUNT][BENCH_OPS];
+  size_t lengths[BENCH_SIZE_COUNT];
+
+  char* original = strdup(currentConfig);
+  if (!original) {
+    server.send(503, "text/plain", "Out of memory");
+    return;
+  }
+  size_t savedPoolPeak = jsonPool.stats().peakUsed;
+  uint32_t bytesBefore = configBytesWritten;
+  configQuiet = true;
+  for (size_t step = 0; step < BENCH_SIZE_COUNT; step++) {
+    {
+      ScratchBuffer config;
+      lengths[step] = config.data ? benchConfig(config.data, config.size, benchSizes[step]) : 0;
+      if (config.data) saveConfigToEEPROM(config.data);
+    }
+    results[step][0] = benchMeasure(BENCH_RUNS, []() {
+      loadConfigFromEEPROM();
+      return journalSector >= 0;
+    });
+    results[step][1] = benchMeasure(BENCH_RUNS, []() {
+      DeviceConfig cfg = {};
+      return parseConfig(currentConfig, cfg);
+    });
+    results[step][2] = benchMeasure(BENCH_RUNS, []() {
+      ScratchBuffer json;
+      return json.data && mergeDeviceConfig(currentConfig, deviceConfig, json.data, json.size);
+    });
+    results[step][3] = benchMeasure(BENCH_SAVES, []() {
+      size_t length;
+      const char* value = findJsonMember(currentConfig, "configMode", &length);
+      ScratchBuffer json;
+      if (!value || !json.data) return false;
+      const char* mode = strncmp(value, "\"RUN\"", 5) == 0 ? "CONFIG" : "RUN";
+      snprintf(json.data, json.size, "%.*s\"%s\"%s", (int)(value - currentConfig), currentConfig, mode,
+               value + length);
+      uint32_t generation = configGeneration;
+      saveConfigToEEPROM(json.data, mode);
+      return configGeneration != generation;
+    });
+  }
+  saveConfigToEEPROM(original);
+  free(original);
+  storeRtcConfigCache();
+  configQuiet = false;
+  jsonPool.resetPeak(savedPoolPeak);
+  checkStackHighWater("handleBench");
+
+  beginHtmlResponse();
+  sendHtmlHeader("Benchmark");
+  sendHtml(F("<h1>Benchmark</h1>"
+             "<table>"
+             "<tr><th>Size</th><th>Operation</th><th>Cycles (min / avg / max)</th><th>&micro;s</th>"
+             "<th>Pool allocs</th><th>Pool peak</th><th>Heap fallbacks</th><th>Heap &Delta;</th><th>Failed</th></tr>"));
+  Serial.println("Bench: size op cycles(min/avg/max) us allocs poolPeak heapFallbacks heapDelta failed");
+  for (size_t step = 0; step < BENCH_SIZE_COUNT; step++) {
+    for (int op = 0; op < BENCH_OPS; op++) {
+      const BenchStat& stat = results[step][op];
+      unsigned avgMicros = stat.avgCycles / ESP.getCpuFreqMHz();
+      sendHtmlf("<tr><td>%u</td><td>%s</td><td>%u / %u / %u</td><td>%u</td><td>%u</td><td>%u</td><td>%u</td>"
+                "<td>%d</td><td>%u</td></tr>",
+                (unsigned)lengths[step], opNames[op], (unsigned)stat.minCycles, (unsigned)stat.avgCycles,
+                (unsigned)stat.maxCycles, avgMicros, (unsigned)stat.allocations, (unsigned)stat.poolPeak,
+                (unsigned)stat.heapFallbacks, (int)stat.heapDelta, (unsigned)stat.failures);
+      Serial.printf("Bench: %u %s %u/%u/%u %u %u %u %u %d %u\n",
+                    (unsigned)lengths[step], opNames[op], (unsigned)stat.minCycles, (unsigned)stat.avgCycles,
+                    (unsigned)stat.maxCycles, avgMicros, (unsigned)stat.allocations, (unsigned)stat.poolPeak,
+                    (unsigned)stat.heapFallbacks, (int)stat.heapDelta, (unsigned)stat.failures);
+    }
+  }
+  sendHtmlf("</table><p>%d runs per operation (%d saves); %u journal bytes written.</p>",
+            BENCH_RUNS, BENCH_SAVES, (unsigned)(configBytesWritten - bytesBefore));
+  sendHtmlFooter();
+  endHtmlResponse();
+}
+#endif
+
 // configureWebServerRoutes()
 // Sets up all HTTP routes for the web server.
 // - Maps URLs to handler functions.
-// - Includes root, restart, factory reset, JSON editor, network config, favicon.
-// Add more server.on() calls here for custom routes.
+// - Includes root, restart, factory reset, JSON editor, network config, status, stylesheet, favicon.
+// - /bench only in CONFIG_BENCH builds.
+// - /jsonedit POST and /api/config PUT/PATCH read their body as a stream (onStream()) instead of as args.
+// Add more server.on() calls here for custom routes, and serveAsset() calls for files added to web/.
 
 void configureWebServerRoutes() 
 {
   server.on("/", handleRoot);
   server.on("/restart", handleRestart);
   server.on("/factoryreset", handleFactoryReset);
+#ifndef WEB_SERVER_LEGACY
+  server.onStream("/jsonedit", HTTP_POST, handleJsonEditor);
+#endif
   server.on("/jsonedit", handleJsonEditor);
   server.on("/network", handleNetworkConfig);
-  server.on("/favicon.ico", handleFavicon);  // Serve favicon
+  server.on("/status", handleStatus);
+#ifdef CONFIG_BENCH
+  server.on("/bench", HTTP_GET, handleBench);
+#endif
+  server.on("/api/config", HTTP_GET, handleApiConfig);
+#ifdef WEB_SERVER_LEGACY
+  server.on("/api/config", HTTP_PUT, handleApiConfigUpdate);
+  server.on("/api/config", HTTP_PATCH, handleApiConfigUpdate);
+#else
+  server.onStream("/api/config", HTTP_PUT, handleApiConfigUpdate);
+  server.onStream("/api/config", HTTP_PATCH, handleApiConfigUpdate);
+#endif
+  serveAsset("/style.css", styleCssAsset);
+  serveAsset("/favicon.ico", faviconAsset);
 }
 
 // sendHtmlHeader(const char* title)
-// Sends common HTML header with title, meta, CSS, body start, header, navigation menu.
-// - Uses sendContent() for chunked sending.
+// Sends common HTML header with title, meta, CSS link, body start, header, navigation menu.
+// - The stylesheet URL carries the CSS ETag as a version, so browsers can cache it indefinitely.
+// - Writes through sendHtml(), so the whole header normally leaves in a single chunk.
 // - Navigation includes dropdown for config options.
 // Called at the start of most handler responses.
 
 void sendHtmlHeader(const char* title) {
-  server.sendContent(F("<!DOCTYPE html><html><head><meta charset='UTF-8'>"
-                       "<meta name='viewport' content='width=device-width, initial-scale=1'>"
-                       "<title>"));
-  server.sendContent(title);
-  server.sendContent(F("</title><style>"));
-  server.sendContent_P(css);
-  server.sendContent(F("</style></head><body>"
-                       "<header><h1>ESP01 Web Template</h1></header>"
-                       "<nav>"
-                       "<ul>"
-                       "<li><a href='/'>Home</a></li>"));
-  server.sendContent(F("<li class=\"dropdown\">"
-                       "<a href='javascript:void(0)'>Config</a>"
-                       "<div class=\"dropdown-content\">"
-                       "<a href='/network'>Network Config</a>"
-                       "<a href='/jsonedit'>Json Edit</a>"
-                       "<a href='/restart'>Restart</a>"
-                       "<a href='/factoryreset'>Reset to Factory</a>"
-                       "</div></li>"
-                       "</ul></nav>"));
+  sendHtml(F("<!DOCTYPE html><html><head><meta charset='UTF-8'>"
+             "<meta name='viewport' content='width=device-width, initial-scale=1'>"
+             "<title>"));
+  sendHtml(title);
+  sendHtml(F("</title><link rel='stylesheet' href='/style.css?v="));
+  sendHtml(STYLE_CSS_ETAG + 1, sizeof(STYLE_CSS_ETAG) - 3); // ETag without its quotes
+  sendHtml(F("'></head><body>"
+             "<header><h1>ESP01 Web Template</h1></header>"
+             "<nav>"
+             "<ul>"
+             "<li><a href='/'>Home</a></li>"));
+  sendHtml(F("<li class=\"dropdown\">"
+             "<a href='javascript:void(0)'>Config</a>"
+             "<div class=\"dropdown-content\">"
+             "<a href='/network'>Network Config</a>"
+             "<a href='/jsonedit'>Json Edit</a>"
+             "<a href='/status'>Status</a>"
+             "<a href='/restart'>Restart</a>"
+             "<a href='/factoryreset'>Reset to Factory</a>"
+             "</div></li>"
+             "</ul></nav>"));
 }
 
 // sendHtmlFooter()
@@ -767,18 +2351,240 @@ void sendHtmlHeader(const char* title) {
 
 void sendHtmlFooter() 
 {
-  server.sendContent(F("<hr><p>© 2025 ESP01 Web Template</p></body></html>"));
+  sendHtml(F("<hr><p>© 2025 ESP01 Web Template</p></body></html>"));
+}
+
+// beginHtmlResponse()
+// Starts a chunked 200 text/html response and empties the response buffer.
+// - Follow with sendHtmlHeader(), sendHtml()/sendHtmlf() for the body, sendHtmlFooter() and endHtmlResponse().
+// - Headers added before (e.g. by sendNotModifiedIfCurrent()) go out with it.
+
+void beginHtmlResponse()
+{
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/html", "");
+  htmlLength = 0;
+  htmlChunks = 0;
+  htmlBytes = 0;
+  htmlStartTime = millis();
+}
+
+// flushHtml()
+// Sends the buffered bytes as one HTTP chunk. Called by the writers when the buffer is full and by
+// endHtmlResponse().
+
+void flushHtml()
+{
+  if (htmlLength == 0) return;
+  server.sendContent(htmlBuffer, htmlLength);
+  htmlChunks++;
+  htmlBytes += htmlLength;
+  htmlLength = 0;
+}
+
+// sendHtml(const char* data, size_t length) / sendHtml(const char* text)
+// Appends RAM data to the response buffer, flushing whenever it fills up.
+// Long content (e.g. currentConfig) is split across chunks as needed.
+
+void sendHtml(const char* data, size_t length)
+{
+  while (length > 0) {
+    size_t count = min(length, HTML_BUFFER_SIZE - htmlLength);
+    memcpy(htmlBuffer + htmlLength, data, count);
+    htmlLength += count;
+    data += count;
+    length -= count;
+    if (htmlLength == HTML_BUFFER_SIZE) flushHtml();
+  }
+}
+
+void sendHtml(const char* text)
+{
+  sendHtml(text, strlen(text));
+}
+
+// sendHtml(const __FlashStringHelper* text)
+// Appends an F() string, copying it straight from flash into the response buffer.
+
+void sendHtml(const __FlashStringHelper* text)
+{
+  PGM_P data = reinterpret_cast<PGM_P>(text);
+  size_t length = strlen_P(data);
+  while (length > 0) {
+    size_t count = min(length, HTML_BUFFER_SIZE - htmlLength);
+    memcpy_P(htmlBuffer + htmlLength, data, count);
+    htmlLength += count;
+    data += count;
+    length -= count;
+    if (htmlLength == HTML_BUFFER_SIZE) flushHtml();
+  }
+}
+
+// sendHtmlf(const char* format, ...)
+// Appends printf-style output directly into the response buffer.
+// - If the field does not fit in the remaining space, the buffer is flushed and the field formatted again.
+// - A single field is limited to HTML_BUFFER_SIZE - 1 characters; use sendHtml() for longer content.
+
+void sendHtmlf(const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  va_list retry;
+  va_copy(retry, args);
+  size_t space = HTML_BUFFER_SIZE - htmlLength;
+  int length = vsnprintf(htmlBuffer + htmlLength, space, format, args);
+  if (length >= 0 && (size_t)length >= space) {
+    flushHtml();
+    length = vsnprintf(htmlBuffer, HTML_BUFFER_SIZE, format, retry);
+    length = min(length, (int)HTML_BUFFER_SIZE - 1);
+  }
+  va_end(retry);
+  va_end(args);
+  if (length > 0) htmlLength += length;
+}
+
+// endHtmlResponse()
+// Flushes the response buffer and ends the chunked response.
+// - Records size, chunk count and send time as the last page shown on /status. CONFIG_BENCH builds also log
+//   them to Serial; production builds do not print on every page.
+
+void endHtmlResponse()
+{
+  flushHtml();
+  server.sendContent("");
+  strlcpy(lastPageUri, server.uri().c_str(), sizeof(lastPageUri));
+  lastPageChunks = htmlChunks;
+  lastPageBytes = htmlBytes;
+  lastPageMs = millis() - htmlStartTime;
+#ifdef CONFIG_BENCH
+  Serial.printf("Page %s: %u bytes in %u chunks, %lu ms\n",
+                lastPageUri, (unsigned)lastPageBytes, (unsigned)lastPageChunks, lastPageMs);
+#endif
+}
+
+// etagListMatches(const char* list, const char* etag, bool weak)
+// Returns true if an If-Match / If-None-Match value names etag (a quoted entity-tag) or is "*".
+// - The list is read member by member (comma separated, whitespace around members ignored), and each
+//   quoted tag is compared with etag for equality; a tag that merely contains etag does not match.
+// - Strong comparison (weak false, required for If-Match by RFC 9110 13.1.1): a weak W/"..." member never
+//   matches. Weak comparison (for If-None-Match): the W/ prefix of a member is ignored.
+// - A malformed list matches nothing from the first member that is not a quoted tag.
+
+bool etagListMatches(const char* list, const char* etag, bool weak)
+{
+  size_t etagLength = strlen(etag);
+  const char* member = list;
+  while (*member == ' ' || *member == '\t') member++;
+  if (*member == '*') {
+    member++;
+    while (*member == ' ' || *member == '\t') member++;
+    return *member == '\0';
+  }
+  for (;;) {
+    while (*member == ' ' || *member == '\t' || *member == ',') member++;
+    if (*member == '\0') return false;
+    bool weakTag = strncmp(member, "W/", 2) == 0;
+    const char* tag = weakTag ? member + 2 : member;
+    const char* tagEnd = *tag == '"' ? strchr(tag + 1, '"') : nullptr;
+    if (!tagEnd) return false;
+    size_t length = tagEnd + 1 - tag;
+    if ((weak || !weakTag) && length == etagLength && strncmp(tag, etag, length) == 0) return true;
+    member = tagEnd + 1;
+    while (*member == ' ' || *member == '\t') member++;
+    if (*member != ',' && *member != '\0') return false;
+  }
+}
+
+// requestMatchesETag(const char* etag)
+// Returns true if the request's If-None-Match header lists etag (or is "*"), by weak comparison as allowed
+// for If-None-Match (see etagListMatches()).
+
+bool requestMatchesETag(const char* etag)
+{
+  if (!server.hasHeader("If-None-Match")) return false;
+  return etagListMatches(server.header("If-None-Match").c_str(), etag, true);
 }
 
-// handleFavicon()
-// Serves the favicon.ico as PNG from PROGMEM.
-// - Responds with 200 and image data.
+// sendNotModifiedIfCurrent(const char* etag, const char* cacheControl)
+// Adds the ETag and Cache-Control headers to the response being built and answers a conditional GET.
+// - If the client already has this version, sends 304 Not Modified (no body) and returns true.
+// - Otherwise returns false and the caller sends the full response, which carries the same headers.
 
-void handleFavicon() 
+bool sendNotModifiedIfCurrent(const char* etag, const char* cacheControl)
 {
-  server.send_P(200, "image/png", (const char*)database_icon_png, database_icon_png_len);
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", cacheControl);
+  if (requestMatchesETag(etag)) {
+    server.send(304);
+    return true;
+  }
+  return false;
 }
 
+// pageETag(char* etag, size_t size, const char* content)
+// Builds the strong ETag of a rendered page: a hash of the firmware build and of the content the page shows
+// (e.g. currentConfig); pass nullptr for pages that only depend on the firmware.
+
+void pageETag(char* etag, size_t size, const char* content)
+{
+  uint32_t buildHash = configCrc32(firmwareBuildId, strlen(firmwareBuildId));
+  uint32_t contentHash = content ? configCrc32(content, strlen(content)) : 0;
+  snprintf(etag, size, "\"%08x%08x\"", (unsigned)buildHash, (unsigned)contentHash);
+}
+
+// configETag(char* etag, size_t size)
+// Builds the strong ETag of the stored JSON config (CRC32 of currentConfig), as used by /api/config.
+// Unlike pageETag() it does not depend on the firmware build: the JSON is the same whatever renders it.
+
+void configETag(char* etag, size_t size)
+{
+  snprintf(etag, size, "\"%08x\"", (unsigned)configCrc32(currentConfig, strlen(currentConfig)));
+}
+
+// checkStackHighWater(const char* where)
+// Reads the continuation stack's high-water mark (ESP.getFreeContStack(): least free stack since boot, from the
+// core's stack painting) at the end of a deep call path and remembers where it was lowest.
+// - Logs each new low, with a warning below STACK_LOW_WATER. Called after config saves and from /status.
+// On the host the shim paints the host stack instead (lib/NativeShims/src/Esp.h); test/test_config_stack
+// bounds the JSON editor and /network POST paths with it.
+
+void checkStackHighWater(const char* where)
+{
+  uint32_t freeStack = ESP.getFreeContStack();
+  if (freeStack >= stackLowestFree) return;
+  stackLowestFree = freeStack;
+  stackLowestWhere = where;
+  Serial.printf("Stack high-water after %s: %u bytes free\n", where, (unsigned)freeStack);
+  if (freeStack < STACK_LOW_WATER) {
+    Serial.println("Warning: continuation stack nearly exhausted");
+  }
+}
+
+// sendAsset(const WebAsset& asset)
+// Sends a PROGMEM asset, or 304 if the client's If-None-Match matches its compile-time ETag.
+// - Gzipped assets get Content-Encoding: gzip.
+// - Cache-Control is one year and immutable: pages reference versioned URLs (see sendHtmlHeader()), and
+//   unversioned requests such as /favicon.ico still revalidate cheaply through the ETag.
+
+void sendAsset(const WebAsset& asset)
+{
+  if (sendNotModifiedIfCurrent(asset.etag, "public, max-age=31536000, immutable")) {
+    return;
+  }
+  if (asset.gzipped) {
+    server.sendHeader("Content-Encoding", "gzip");
+  }
+  server.send_P(200, asset.contentType, (const char*)asset.data, asset.length);
+}
+
+// serveAsset(const char* uri, const WebAsset& asset)
+// Registers a GET route that serves asset with conditional GET support.
+// Use this in configureWebServerRoutes() for any static content compiled into the firmware.
+
+void serveAsset(const char* uri, const WebAsset& asset)
+{
+  server.on(uri, HTTP_GET, [&asset]() { sendAsset(asset); });
+}
 
 //=====================================================================
 // Setup
@@ -786,13 +2592,15 @@ void handleFavicon()
 // setup()
 // Arduino setup function, runs once on boot.
 // - Initializes hardware, config, WiFi, web server.
-// - Determines currentState based on WiFi init.
+// - On a warm boot the config comes from RTC memory and the flash journal is loaded while WiFi connects.
+// - Determines currentState based on WiFi init; returns without waiting for the STA connection.
 
 void setup() 
 {
   initHardware();
   initConfig();
   currentState = initWiFi();
+  finishConfigLoad();
   initWebServer();
 }
 
@@ -801,14 +2609,17 @@ void setup()
 // =====================================================================
 // loop()
 // Main Arduino loop, runs repeatedly.
-// - Handles web server clients.
+// - Steps the WiFi connection state machine.
+// - Handles web server clients: dispatches the requests that have arrived, without waiting on any client.
 // - Handles button input.
 // - Based on currentState:
 //   - STATE_RUN: Place your normal application code here (e.g., sensor reading, MQTT).
+//     Check wifiState == WIFI_STATE_CONNECTED before using the network; setup() no longer waits for the link.
 //   - STATE_CONFIG: Runs config-specific code (currently empty; add if needed).
 // - Delay 10ms for WiFi processing.
 
 void loop() {
+  updateWiFi();
   server.handleClient();
   handleButton();
 
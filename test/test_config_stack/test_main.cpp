@@ -0,0 +1,110 @@
+// =====================================================================
+// test_config_stack
+// =====================================================================
+// Stack high-water of the config POST paths, on the host shims:
+//   pio test -e native
+// - Boots the sketch (src/main.cpp, compiled into the test as the fuzz targets do) and POSTs through the
+//   loopback web server with the stack painted by ESP.resetFreeContStack() (see lib/NativeShims/src/Esp.h).
+// - The JSON editor POST of a full-size config (every byte URL-encoded) and the /network POST must each stay
+//   below CONFIG_POST_STACK_BOUND bytes of host stack, counted from the frame that sends the request. The
+//   bound is twice the device's 4 KB cont stack, to allow for x86-64 frames at -O0; the figure of each path is
+//   printed, so a change that moves buffers back onto the stack (see ScratchBuffer) shows up before the bound.
+
+#include <ArduinoJson.h> // Named here, not only in src/main.cpp, so the library finder links them
+#include <Bounce2.h>
+#include <AsyncHttpServer.h>
+#include <JsonPoolAllocator.h>
+#include "../../src/main.cpp"
+#include <HttpLoopback.h>
+#include <string>
+#include <unity.h>
+
+static const uint32_t CONFIG_POST_STACK_BOUND = 8192;
+static const int MAX_PASSES = 100; // handleClient() calls allowed for one response
+
+static std::string baseline;
+
+// postStackUse(const char* path, const std::string& body, int& status)
+// POSTs body as a form to path and returns the stack used while the server handled it; status is set from
+// the response (0 if none arrived).
+
+static uint32_t postStackUse(const char* path, const std::string& body, int& status)
+{
+  HttpLoopbackClient client;
+  TEST_ASSERT_TRUE(client.connect(80));
+  client.send(std::string("POST ") + path + " HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n"
+              "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+              std::to_string(body.size()) + "\r\n\r\n" + body);
+  ESP.resetFreeContStack();
+  for (int pass = 0; pass < MAX_PASSES && !client.responseLength(); pass++) {
+    server.handleClient();
+    nativePump();
+  }
+  uint32_t used = NATIVE_CONT_STACK_SIZE - ESP.getFreeContStack();
+  status = client.responseLength() ? atoi(client.received().c_str() + 9) : 0;
+  char message[80];
+  snprintf(message, sizeof(message), "POST %s: %u bytes of stack", path, (unsigned)used);
+  TEST_MESSAGE(message);
+  return used;
+}
+
+// urlEncodeAll(const std::string& text)
+// Percent-encodes every byte, the worst case for the form decoding.
+
+static std::string urlEncodeAll(const std::string& text)
+{
+  std::string encoded;
+  char hex[4];
+  for (unsigned char c : text) {
+    snprintf(hex, sizeof(hex), "%%%02X", c);
+    encoded += hex;
+  }
+  return encoded;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+  saveConfigToEEPROM(baseline.c_str());
+  parseConfig(currentConfig, deviceConfig);
+}
+
+// The JSON editor saving a config of the largest size it accepts.
+void test_json_editor_post_stack()
+{
+  std::string json = "{\"network\":{\"ssid\":\"Home\",\"password\":\"secret\",\"useDhcp\":true},"
+                     "\"configMode\":\"RUN\",\"note\":\"";
+  json.append(EEPROM_SIZE - 1 - json.size() - 2, 'x');
+  json += "\"}";
+  TEST_ASSERT_EQUAL(EEPROM_SIZE - 1, json.size());
+  int status;
+  uint32_t used = postStackUse("/jsonedit", "jsondata=" + urlEncodeAll(json), status);
+  TEST_ASSERT_EQUAL(303, status);
+  TEST_ASSERT_LESS_THAN_UINT32(CONFIG_POST_STACK_BOUND, used);
+}
+
+// The /network form, which rebuilds the JSON (persistConfig()) and applies the IP settings.
+void test_network_post_stack()
+{
+  int status;
+  uint32_t used = postStackUse("/network", "ssid=Home&password=secret&useDhcp=0&staticIp=192.168.1.50"
+                               "&gateway=192.168.1.1&subnet=255.255.255.0&apFallbackSec=300", status);
+  TEST_ASSERT_EQUAL(303, status);
+  TEST_ASSERT_LESS_THAN_UINT32(CONFIG_POST_STACK_BOUND, used);
+}
+
+int main()
+{
+  nativeSetSerialOutput(nullptr);
+  nativeBoot(REASON_DEFAULT_RST);
+  setup();
+  baseline = currentConfig;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_json_editor_post_stack);
+  RUN_TEST(test_network_post_stack);
+  return UNITY_END();
+}
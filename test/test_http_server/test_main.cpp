@@ -0,0 +1,341 @@
+// =====================================================================
+// test_http_server
+// =====================================================================
+// Loopback tests of AsyncHttpServer against slow clients, on the host shims (virtual millis()):
+//   pio test -e native
+// - A client that drip-feeds a request body must not hold up handleClient() or the other clients.
+// - A request that keeps trickling in is dropped after HTTP_REQUEST_MAX_TIME, although it never stalls for
+//   HTTP_REQUEST_TIMEOUT.
+// - A streamed (onStream()) body reaches its handler complete, and a request pipelined behind it is answered.
+// - formField() decodes one form field in place, and a 2 KB value fits even if every byte is URL-encoded.
+// - A large response to a client that reads slowly is queued: the handler returns at once, other clients are
+//   served, and the whole response arrives intact. One beyond HTTP_BUFFER_BUDGET is cut off.
+
+#include <Arduino.h>
+#include <AsyncHttpServer.h>
+#include <HttpLoopback.h>
+#include <string>
+#include <unity.h>
+
+static const unsigned long TICK_MS = 50;     // Virtual time between handleClient() calls
+static const int MAX_PASSES = 10;            // handleClient() calls allowed for a response to a waiting client
+
+static AsyncHttpServer server(80);
+static int uploadCalls;
+static size_t uploadLength;
+static std::string uploadBody;
+
+// handleUpload()
+// onStream() route: reads the whole body and answers with its length.
+
+static void handleUpload()
+{
+  uploadCalls++;
+  uploadBody.clear();
+  char buffer[64];
+  size_t count;
+  while ((count = server.body().readBytes(buffer, sizeof(buffer))) > 0) {
+    uploadBody.append(buffer, count);
+  }
+  uploadLength = uploadBody.size();
+  server.send(200, "text/plain", String((unsigned)uploadLength));
+}
+
+// handleForm()
+// onStream() route: answers with the decoded jsondata field, or 404 if the body has none.
+
+static void handleForm()
+{
+  uploadCalls++;
+  const char* value = server.formField("jsondata");
+  if (!value) {
+    server.send(404, "text/plain", "missing");
+    return;
+  }
+  uploadBody = value;
+  server.send(200, "text/plain", value);
+}
+
+// handleLarge()
+// Answers with a chunked body of arg("size") bytes of largeByte(), in 512-byte sendContent() calls.
+
+static int largeCalls;
+
+static char largeByte(size_t i)
+{
+  return 'a' + i % 26;
+}
+
+static void handleLarge()
+{
+  largeCalls++;
+  size_t size = server.arg("size").toInt();
+  char piece[512];
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain", "");
+  for (size_t sent = 0; sent < size; ) {
+    size_t count = std::min(size - sent, sizeof(piece));
+    for (size_t i = 0; i < count; i++) {
+      piece[i] = largeByte(sent + i);
+    }
+    server.sendContent(piece, count);
+    sent += count;
+  }
+  server.sendContent("");
+}
+
+static void handlePing()
+{
+  server.send(200, "text/plain", "pong");
+}
+
+// serve(unsigned long& longestPassMs)
+// One handleClient() call followed by TICK_MS of virtual time; records the longest virtual time a single
+// handleClient() call took (a handler waiting for a client shows up here).
+
+static void serve(unsigned long& longestPassMs)
+{
+  unsigned long start = millis();
+  server.handleClient();
+  longestPassMs = std::max(longestPassMs, millis() - start);
+  delay(TICK_MS);
+}
+
+static std::string uploadHead(size_t length, bool keepAlive)
+{
+  return "POST /upload HTTP/1.1\r\nHost: esp\r\nContent-Type: application/json\r\nContent-Length: " +
+         std::to_string(length) + (keepAlive ? "" : "\r\nConnection: close") + "\r\n\r\n";
+}
+
+void setUp()
+{
+  uploadCalls = 0;
+  largeCalls = 0;
+  uploadLength = 0;
+  uploadBody.clear();
+}
+
+void tearDown()
+{
+}
+
+// A body sent one byte per second: the handler must only run once all of it is in, handleClient() must
+// never wait for it, and a second client must be served while it trickles.
+void test_slow_body_does_not_block_other_clients()
+{
+  const size_t bodyLength = 8;
+  unsigned long longestPassMs = 0;
+  HttpLoopbackClient slow;
+  TEST_ASSERT_TRUE(slow.connect(80));
+  slow.send(uploadHead(bodyLength, false));
+  size_t sent = 0;
+  unsigned long nextByte = millis();
+  bool pingServed = false;
+  while (!slow.responseLength() && millis() < 20000) {
+    if (sent < bodyLength && millis() >= nextByte) {
+      slow.send("x", 1);
+      sent++;
+      nextByte += 1000;
+    }
+    if (sent == bodyLength / 2 && !pingServed) {
+      TEST_ASSERT_EQUAL(0, uploadCalls);
+      HttpLoopbackClient fast;
+      TEST_ASSERT_TRUE(fast.connect(80));
+      fast.send("GET /ping HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n\r\n");
+      for (int pass = 0; pass < MAX_PASSES && !fast.responseLength(); pass++) {
+        serve(longestPassMs);
+      }
+      TEST_ASSERT_TRUE_MESSAGE(fast.responseLength() > 0, "second client not served while a body trickles in");
+      TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 200", fast.received().c_str(), 12);
+      pingServed = true;
+    }
+    serve(longestPassMs);
+  }
+  TEST_ASSERT_TRUE(pingServed);
+  TEST_ASSERT_EQUAL(1, uploadCalls);
+  TEST_ASSERT_EQUAL(bodyLength, uploadLength);
+  TEST_ASSERT_TRUE_MESSAGE(longestPassMs < TICK_MS, "handleClient() waited for a slow client");
+}
+
+// A body that keeps coming, one byte every second, never stalls for HTTP_REQUEST_TIMEOUT but must be cut off
+// at HTTP_REQUEST_MAX_TIME.
+void test_trickled_request_is_dropped_after_max_time()
+{
+  const size_t bodyLength = HTTP_REQUEST_MAX_TIME / 1000 * 2;
+  unsigned long longestPassMs = 0;
+  uint32_t timeouts = server.stats().timeouts;
+  HttpLoopbackClient slow;
+  TEST_ASSERT_TRUE(slow.connect(80));
+  unsigned long start = millis();
+  slow.send(uploadHead(bodyLength, false));
+  unsigned long nextByte = millis();
+  while (slow.connected() && millis() - start < 2 * HTTP_REQUEST_MAX_TIME) {
+    if (millis() >= nextByte) {
+      slow.send("x", 1);
+      nextByte += 1000;
+    }
+    serve(longestPassMs);
+  }
+  TEST_ASSERT_FALSE_MESSAGE(slow.connected(), "trickling client kept its connection");
+  TEST_ASSERT_TRUE(millis() - start <= HTTP_REQUEST_MAX_TIME + 2 * TICK_MS);
+  TEST_ASSERT_EQUAL(timeouts + 1, server.stats().timeouts);
+  TEST_ASSERT_EQUAL(0, uploadCalls);
+  TEST_ASSERT_EQUAL(0, server.activeConnections());
+}
+
+// A streamed body arriving with a pipelined request behind it: both are answered, in order, and the handler
+// sees exactly the body.
+void test_streamed_body_then_pipelined_request()
+{
+  const std::string body = "{\"network\":{\"ssid\":\"HomeNetwork\"}}";
+  unsigned long longestPassMs = 0;
+  HttpLoopbackClient client;
+  TEST_ASSERT_TRUE(client.connect(80));
+  client.send(uploadHead(body.size(), true) + body + "GET /ping HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n\r\n");
+  for (int pass = 0; pass < MAX_PASSES && client.connected(); pass++) {
+    serve(longestPassMs);
+  }
+  TEST_ASSERT_EQUAL(1, uploadCalls);
+  TEST_ASSERT_EQUAL_STRING(body.c_str(), uploadBody.c_str());
+  size_t first = client.responseLength();
+  TEST_ASSERT_TRUE(first > 0);
+  TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 200", client.received().c_str(), 12);
+  client.consume(first);
+  TEST_ASSERT_TRUE(client.responseLength() > 0);
+  TEST_ASSERT_TRUE(client.received().find("pong") != std::string::npos);
+}
+
+// post(const std::string& path, const std::string& body)
+// Sends a form POST on a fresh connection and returns the response once it is complete.
+
+static std::string post(const std::string& path, const std::string& body)
+{
+  unsigned long longestPassMs = 0;
+  HttpLoopbackClient client;
+  TEST_ASSERT_TRUE(client.connect(80));
+  client.send("POST " + path + " HTTP/1.1\r\nHost: esp\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+              "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+  for (int pass = 0; pass < MAX_PASSES && !client.responseLength(); pass++) {
+    serve(longestPassMs);
+  }
+  return client.received().substr(0, client.responseLength());
+}
+
+// A form field is decoded in place ('+', %XX, the fields around it left out); a missing field is reported.
+void test_form_field_decoded_in_place()
+{
+  std::string response = post("/form", "a=1&jsondata=%7B%22x%22%3A+1%7D&b=2");
+  TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 200", response.c_str(), 12);
+  TEST_ASSERT_EQUAL_STRING("{\"x\": 1}", uploadBody.c_str());
+  response = post("/form", "jsondat=1&xjsondata=2");
+  TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 404", response.c_str(), 12);
+}
+
+// The largest config the JSON editor stores (2047 bytes), with every byte URL-encoded, is not refused with 413.
+void test_full_size_encoded_form_fits()
+{
+  std::string body = "jsondata=";
+  for (int i = 0; i < 2047; i++) {
+    body += "%7B";
+  }
+  std::string response = post("/form", body);
+  TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 200", response.c_str(), 12);
+  TEST_ASSERT_EQUAL(2047, uploadBody.size());
+}
+
+// dechunk(const std::string& response)
+// Returns the body of a complete chunked response.
+
+static std::string dechunk(const std::string& response)
+{
+  std::string body;
+  size_t pos = response.find("\r\n\r\n") + 4;
+  for (;;) {
+    size_t chunk = strtoul(response.c_str() + pos, nullptr, 16);
+    if (chunk == 0) return body;
+    pos = response.find("\r\n", pos) + 2;
+    body.append(response, pos, chunk);
+    pos += chunk + 2;
+  }
+}
+
+// An 8 KB page to a client that takes 256 bytes at a time: the handler must not wait for it, a second client
+// must be answered meanwhile, and the page must arrive complete once the client has read it all.
+void test_slow_reader_does_not_block_handler()
+{
+  const size_t size = 8192;
+  unsigned long longestPassMs = 0;
+  uint32_t cut = server.stats().responsesCut;
+  HttpLoopbackClient slow;
+  TEST_ASSERT_TRUE(slow.connect(80));
+  slow.setSendWindow(256);
+  slow.send("GET /large?size=" + std::to_string(size) + " HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n\r\n");
+  serve(longestPassMs);
+  TEST_ASSERT_EQUAL(1, largeCalls);
+  TEST_ASSERT_TRUE_MESSAGE(server.stats().bufferedBytes > 0, "nothing queued for the slow reader");
+
+  HttpLoopbackClient fast;
+  TEST_ASSERT_TRUE(fast.connect(80));
+  fast.send("GET /ping HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n\r\n");
+  for (int pass = 0; pass < MAX_PASSES && !fast.responseLength(); pass++) {
+    serve(longestPassMs);
+  }
+  TEST_ASSERT_TRUE_MESSAGE(fast.responseLength() > 0, "second client not served while a page is queued");
+
+  std::string response;
+  for (int pass = 0; pass < 1000 && slow.connected(); pass++) {
+    response += slow.received();
+    slow.consume(slow.received().size());
+    serve(longestPassMs);
+  }
+  response += slow.received();
+  std::string body = dechunk(response);
+  TEST_ASSERT_EQUAL(size, body.size());
+  for (size_t i = 0; i < size; i++) {
+    if (body[i] != largeByte(i)) TEST_ASSERT_EQUAL(largeByte(i), body[i]);
+  }
+  TEST_ASSERT_EQUAL(cut, server.stats().responsesCut);
+  TEST_ASSERT_EQUAL(0, server.stats().bufferedBytes);
+  TEST_ASSERT_TRUE_MESSAGE(longestPassMs < TICK_MS, "handleClient() waited for a slow reader");
+}
+
+// A response that would queue more than HTTP_BUFFER_BUDGET for a client that reads nothing is cut off, and
+// its memory goes back to the budget.
+void test_response_over_budget_is_cut()
+{
+  unsigned long longestPassMs = 0;
+  uint32_t cut = server.stats().responsesCut;
+  HttpLoopbackClient stalled;
+  TEST_ASSERT_TRUE(stalled.connect(80));
+  stalled.setSendWindow(0);
+  stalled.send("GET /large?size=" + std::to_string(HTTP_BUFFER_BUDGET + 2 * HTTP_TX_BUFFER_SIZE) +
+               " HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n\r\n");
+  serve(longestPassMs);
+  TEST_ASSERT_EQUAL(1, largeCalls);
+  TEST_ASSERT_TRUE(stalled.reset());
+  TEST_ASSERT_EQUAL(cut + 1, server.stats().responsesCut);
+  TEST_ASSERT_EQUAL(0, server.stats().bufferedBytes);
+  TEST_ASSERT_EQUAL(0, server.activeConnections());
+  TEST_ASSERT_TRUE(longestPassMs < TICK_MS);
+}
+
+int main()
+{
+  nativeSetSerialOutput(nullptr);
+  nativeBoot(REASON_DEFAULT_RST);
+  server.onStream("/upload", HTTP_POST, handleUpload);
+  server.onStream("/form", HTTP_POST, handleForm);
+  server.on("/ping", HTTP_GET, handlePing);
+  server.on("/large", HTTP_GET, handleLarge);
+  server.begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_slow_body_does_not_block_other_clients);
+  RUN_TEST(test_trickled_request_is_dropped_after_max_time);
+  RUN_TEST(test_streamed_body_then_pipelined_request);
+  RUN_TEST(test_form_field_decoded_in_place);
+  RUN_TEST(test_full_size_encoded_form_fits);
+  RUN_TEST(test_slow_reader_does_not_block_handler);
+  RUN_TEST(test_response_over_budget_is_cut);
+  return UNITY_END();
+}
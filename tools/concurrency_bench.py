@@ -0,0 +1,117 @@
+# Measures how the device's web server copes with concurrent and slow clients.
+#
+# Usage: python tools/concurrency_bench.py <device-ip> [--clients 3] [--requests 20] [--slow 1] [--path /status]
+#                                          [--keep-alive]
+# - "clients" threads each fetch the path "requests" times, one new connection per request, or over one
+#   persistent connection per client with --keep-alive (reopened if the server closes it).
+# - Meanwhile "slow" connections send their request one byte per second, like a phone on a weak link.
+# - Prints completed/failed requests, TCP connections opened, latency (median, p95, max) and throughput.
+# - Keep clients + slow within HTTP_MAX_CONNECTIONS (4), or the extra connections are refused.
+#
+# Run it against the default build and the esp01_legacyweb build (ESP8266WebServer) to compare:
+# with the old server each slow connection stalls every other client until it times out.
+
+import argparse
+import http.client
+import socket
+import statistics
+import threading
+import time
+
+
+class CountingConnection(http.client.HTTPConnection):
+    opened = 0
+    lock = threading.Lock()
+
+    def connect(self):
+        super().connect()
+        with CountingConnection.lock:
+            CountingConnection.opened += 1
+
+
+def fetch(connection, path, keep_alive):
+    start = time.monotonic()
+    connection.request("GET", path, headers={} if keep_alive else {"Connection": "close"})
+    response = connection.getresponse()
+    response.read()
+    if response.status != 200:
+        raise IOError("unexpected status %d" % response.status)
+    if not keep_alive:
+        connection.close()
+    return time.monotonic() - start
+
+
+def slow_client(host, port, path, stop):
+    request = ("GET %s HTTP/1.1\r\nHost: %s\r\n\r\n" % (path, host)).encode()
+    try:
+        with socket.create_connection((host, port), timeout=30) as sock:
+            for byte in request:
+                if stop.is_set():
+                    return
+                sock.sendall(bytes([byte]))
+                time.sleep(1)
+    except OSError:
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--path", default="/status")
+    parser.add_argument("--clients", type=int, default=3)
+    parser.add_argument("--requests", type=int, default=20)
+    parser.add_argument("--slow", type=int, default=1)
+    parser.add_argument("--timeout", type=float, default=10.0)
+    parser.add_argument("--keep-alive", action="store_true")
+    args = parser.parse_args()
+
+    stop = threading.Event()
+    slow_threads = [threading.Thread(target=slow_client, args=(args.host, args.port, args.path, stop), daemon=True)
+                    for _ in range(args.slow)]
+    for thread in slow_threads:
+        thread.start()
+    time.sleep(0.5)  # Let the slow clients occupy the server first
+
+    latencies = []
+    failures = []
+    lock = threading.Lock()
+
+    def worker():
+        connection = CountingConnection(args.host, args.port, timeout=args.timeout)
+        for _ in range(args.requests):
+            try:
+                latency = fetch(connection, args.path, args.keep_alive)
+                with lock:
+                    latencies.append(latency)
+            except (OSError, http.client.HTTPException) as error:
+                connection.close()
+                with lock:
+                    failures.append(str(error))
+        connection.close()
+
+    start = time.monotonic()
+    workers = [threading.Thread(target=worker) for _ in range(args.clients)]
+    for thread in workers:
+        thread.start()
+    for thread in workers:
+        thread.join()
+    elapsed = time.monotonic() - start
+    stop.set()
+
+    print("%d clients x %d requests to %s with %d slow client(s)%s" % (args.clients, args.requests, args.path,
+                                                                       args.slow, ", keep-alive" if args.keep_alive else ""))
+    print("completed %d, failed %d in %.1f s (%.1f req/s)" % (len(latencies), len(failures), elapsed,
+                                                             len(latencies) / elapsed))
+    print("TCP connections opened: %d" % CountingConnection.opened)
+    if latencies:
+        latencies.sort()
+        p95 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.95))]
+        print("latency ms: median %.0f, p95 %.0f, max %.0f" % (statistics.median(latencies) * 1000, p95 * 1000,
+                                                               latencies[-1] * 1000))
+    for error in sorted(set(failures)):
+        print("error: %s" % error)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,222 @@
+// Per-request cost of the config-driven paths with and without the typed DeviceConfig: GET /network and the
+// button's mode toggle, each run as the firmware does it now and with the JSON work the template used to do on
+// every call (deserializeJson of currentConfig before rendering the page; parse, modify and serialize the whole
+// document for a toggle). The sketch itself runs on the host shims (env:native) and pages are served through
+// the loopback, so both variants of a path include the same rendering and server work; the difference between
+// them is the per-request saving of parsing the config once.
+//
+// Build and run (its main() replaces the default one of lib/NativeMain):
+//   pio run -e native_request_bench && .pio/build/native_request_bench/program [options]
+//   --requests N    GET /network requests per variant (default 2000)
+//   --toggles N     Mode toggles per variant (default 200; each one writes the config journal)
+//   --app BYTES     Project-specific keys added to the config before measuring (default 1024, 0 = defaults)
+// - Host times only compare the variants; the ESP8266 at 80 MHz is roughly 50-100x slower. JSON pool
+//   allocations and flash bytes per request are exact.
+// - The "before" variants allocate from jsonPool too (the template used the heap), so their JSON memory shows
+//   up in the pool columns.
+
+#include <Arduino.h>
+#include <AsyncHttpServer.h>
+#include <HttpLoopback.h>
+#include <JsonFieldScanner.h>
+#include <JsonPoolAllocator.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+void setup();
+bool applyConfigJson(const char* newJson);
+bool persistConfigMode(const char* mode);
+bool saveConfigToEEPROM(const char* newConfig);
+extern AsyncHttpServer server;
+extern JsonPoolAllocator jsonPool;
+extern char currentConfig[];
+
+static const int MAX_PASSES = 100;           // server.handleClient() calls allowed for one response
+static const size_t CONFIG_SIZE = 2048;      // EEPROM_SIZE of the sketch
+
+static volatile size_t fieldsSink;           // Keeps the copied network fields from being optimized away
+
+struct Result {
+  double medianUs;
+  double meanUs;
+  double allocations;                        // JSON pool allocations per run
+  size_t poolPeak;                           // Largest JSON pool use of any run
+  double flashBytes;                         // Bytes programmed per run
+  unsigned failures;
+};
+
+// measure(int runs, Op op)
+// Runs op (returning false on failure) runs times and collects host time, JSON pool use and flash writes.
+
+template<typename Op>
+static Result measure(int runs, Op op)
+{
+  Result result = {};
+  std::vector<double> times;
+  uint32_t allocations = jsonPool.stats().allocations;
+  uint32_t bytesWritten = nativeFlashStats().bytesWritten;
+  jsonPool.resetPeak();
+  for (int run = 0; run < runs; run++) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = op();
+    auto end = std::chrono::steady_clock::now();
+    times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    result.failures += !ok;
+  }
+  std::sort(times.begin(), times.end());
+  result.medianUs = times[times.size() / 2];
+  for (double time : times) {
+    result.meanUs += time / times.size();
+  }
+  result.allocations = (double)(jsonPool.stats().allocations - allocations) / runs;
+  result.poolPeak = jsonPool.stats().peakUsed;
+  result.flashBytes = (double)(nativeFlashStats().bytesWritten - bytesWritten) / runs;
+  return result;
+}
+
+// getNetworkPage()
+// GET /network through a loopback client; true if a complete 200 response came back.
+
+static bool getNetworkPage()
+{
+  static const char request[] = "GET /network HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n\r\n";
+  HttpLoopbackClient client;
+  if (!client.connect(80)) return false;
+  client.send(request, sizeof(request) - 1);
+  for (int pass = 0; pass < MAX_PASSES && !client.responseLength(); pass++) {
+    server.handleClient();
+    nativePump();
+  }
+  return client.responseLength() && client.received().compare(0, 12, "HTTP/1.1 200") == 0;
+}
+
+// parseNetworkFields()
+// What the template's GET /network did before rendering: parse the whole stored config and copy out the
+// network settings.
+
+static bool parseNetworkFields()
+{
+  JsonDocument doc(&jsonPool);
+  if (deserializeJson(doc, currentConfig)) return false;
+  JsonObject netObj = doc["network"];
+  char ssid[32], password[64], staticIp[16], gateway[16], subnet[16];
+  bool useDhcp = netObj["useDhcp"] | true;
+  strlcpy(ssid, netObj["ssid"] | "", sizeof(ssid));
+  strlcpy(password, netObj["password"] | "", sizeof(password));
+  strlcpy(staticIp, netObj["staticIp"] | "", sizeof(staticIp));
+  strlcpy(gateway, netObj["gateway"] | "", sizeof(gateway));
+  strlcpy(subnet, netObj["subnet"] | "", sizeof(subnet));
+  fieldsSink = useDhcp + strlen(ssid) + strlen(password) + strlen(staticIp) + strlen(gateway) + strlen(subnet);
+  return true;
+}
+
+// toggleByParsing()
+// The template's button toggle: parse the whole config, flip configMode, serialize and save it.
+
+static bool toggleByParsing()
+{
+  static char newJson[CONFIG_SIZE];
+  JsonDocument doc(&jsonPool);
+  if (deserializeJson(doc, currentConfig)) return false;
+  const char* mode = doc["configMode"] | "RUN";
+  doc["configMode"] = strcmp(mode, "CONFIG") == 0 ? "RUN" : "CONFIG";
+  if (measureJson(doc) >= sizeof(newJson)) return false;
+  serializeJson(doc, newJson, sizeof(newJson));
+  return saveConfigToEEPROM(newJson);
+}
+
+// toggleNow()
+// The button toggle of the firmware: the new mode is spliced into the stored JSON (persistConfigMode()).
+
+static bool toggleNow()
+{
+  size_t length;
+  const char* mode = findJsonMember(currentConfig, "configMode", &length);
+  return persistConfigMode(mode && length == 8 && strncmp(mode, "\"CONFIG\"", 8) == 0 ? "RUN" : "CONFIG");
+}
+
+// growConfig(size_t bytes)
+// Appends an "app" object of about bytes bytes of short string members to the stored config and applies it.
+
+static bool growConfig(size_t bytes)
+{
+  std::string config = currentConfig;
+  size_t end = config.rfind('}');
+  if (end == std::string::npos) return false;
+  config.erase(end);
+  config += ",\"app\":{";
+  for (unsigned key = 0; config.size() + 20 < CONFIG_SIZE && key * 16 < bytes; key++) {
+    char member[24];
+    snprintf(member, sizeof(member), "%s\"k%03u\":\"value%04u\"", key ? "," : "", key, key);
+    config += member;
+  }
+  config += "}}";
+  return applyConfigJson(config.c_str());
+}
+
+static void printResult(const char* path, const char* variant, const Result& result)
+{
+  printf("%-14s %-28s %9.2f %9.2f %7.1f %9u %9.1f %8u\n", path, variant, result.medianUs, result.meanUs,
+         result.allocations, (unsigned)result.poolPeak, result.flashBytes, result.failures);
+}
+
+static void printSaving(const char* path, const Result& now, const Result& before)
+{
+  double saved = before.medianUs - now.medianUs;
+  printf("%-14s saving per request: %.2f us median (%.0f%%), %.1f JSON allocations, %.1f flash bytes\n", path,
+         saved, before.medianUs > 0 ? 100.0 * saved / before.medianUs : 0.0, before.allocations - now.allocations,
+         before.flashBytes - now.flashBytes);
+}
+
+int main(int argc, char** argv)
+{
+  int requests = 2000;
+  int toggles = 200;
+  size_t appBytes = 1024;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (hasValue && !strcmp(arg, "--requests")) {
+      requests = atoi(argv[++i]);
+    } else if (hasValue && !strcmp(arg, "--toggles")) {
+      toggles = atoi(argv[++i]);
+    } else if (hasValue && !strcmp(arg, "--app")) {
+      appBytes = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--requests N] [--toggles N] [--app BYTES]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (requests <= 0 || toggles <= 0) {
+    fprintf(stderr, "--requests and --toggles must be positive\n");
+    return 2;
+  }
+
+  nativeSetSerialOutput(nullptr);
+  nativeBoot(REASON_DEFAULT_RST);
+  setup();
+  if (appBytes && !growConfig(appBytes)) {
+    fprintf(stderr, "could not store a config with %u bytes of app keys\n", (unsigned)appBytes);
+    return 1;
+  }
+  printf("Config: %u bytes\n\n", (unsigned)strlen(currentConfig));
+  printf("%-14s %-28s %9s %9s %7s %9s %9s %8s\n", "path", "variant", "median us", "mean us", "allocs", "pool peak",
+         "flash B", "failures");
+
+  Result getNow = measure(requests, getNetworkPage);
+  Result getBefore = measure(requests, []() { return parseNetworkFields() && getNetworkPage(); });
+  printResult("GET /network", "deviceConfig (now)", getNow);
+  printResult("GET /network", "parse per request (before)", getBefore);
+  Result toggleNowResult = measure(toggles, toggleNow);
+  Result toggleBefore = measure(toggles, toggleByParsing);
+  printResult("mode toggle", "persistConfigMode (now)", toggleNowResult);
+  printResult("mode toggle", "parse + serialize (before)", toggleBefore);
+  printf("\n");
+  printSaving("GET /network", getNow, getBefore);
+  printSaving("mode toggle", toggleNowResult, toggleBefore);
+
+  unsigned failures = getNow.failures + getBefore.failures + toggleNowResult.failures + toggleBefore.failures;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+// main() for fuzz targets built without libFuzzer (FUZZ_ENGINE=replay): runs each file named on the command
+// line (or each file in a named directory) through LLVMFuzzerTestOneInput() once, or stdin if there is none,
+// and reports executions per second. Use it to replay a corpus or a crash under GCC's ASan/UBSan, or as the
+// program afl-fuzz runs ("@@" for the file). libFuzzer and AFL++ (afl-clang-fast++ -fsanitize=fuzzer) bring
+// their own main().
+
+#if !defined(FUZZ_LIBFUZZER)
+
+#include <chrono>
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv);
+
+static std::vector<uint8_t> readAll(FILE* file)
+{
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + count);
+  }
+  return data;
+}
+
+// addInputs(const char* path, std::vector<std::string>& files)
+// Adds path, or the regular files in it if it is a directory.
+
+static void addInputs(const char* path, std::vector<std::string>& files)
+{
+  struct stat info;
+  if (stat(path, &info) != 0) {
+    fprintf(stderr, "cannot read %s\n", path);
+    return;
+  }
+  if (!S_ISDIR(info.st_mode)) {
+    files.push_back(path);
+    return;
+  }
+  DIR* dir = opendir(path);
+  while (struct dirent* entry = dir ? readdir(dir) : nullptr) {
+    std::string file = std::string(path) + "/" + entry->d_name;
+    if (stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode)) files.push_back(file);
+  }
+  if (dir) closedir(dir);
+}
+
+int main(int argc, char** argv)
+{
+  LLVMFuzzerInitialize(&argc, &argv);
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) addInputs(argv[i], files);
+  auto start = std::chrono::steady_clock::now();
+  if (argc < 2) {
+    std::vector<uint8_t> data = readAll(stdin);
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+  }
+  for (const std::string& file : files) {
+    FILE* in = fopen(file.c_str(), "rb");
+    if (!in) continue;
+    std::vector<uint8_t> data = readAll(in);
+    fclose(in);
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  size_t runs = argc < 2 ? 1 : files.size();
+  fprintf(stderr, "%u inputs in %.3f s (%.0f exec/s)\n", (unsigned)runs, seconds, seconds > 0 ? runs / seconds : 0);
+  return 0;
+}
+
+#endif // !FUZZ_LIBFUZZER
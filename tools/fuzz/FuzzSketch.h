@@ -0,0 +1,79 @@
+// Shared part of the fuzz targets in tools/fuzz. Compiles the sketch into the target, so targets can reach its
+// types and globals (DeviceConfig has no header), and drives it on the host shims (lib/NativeShims).
+// - fuzzBoot(): boots once from erased flash with Serial discarded; the default config it saves is the baseline.
+// - fuzzPost(): sends one POST through the loopback web server and returns the response status.
+// - fuzzRestore(): puts the baseline config back after an input changed it, so every input starts from the
+//   same state and a crash reproduces from its input alone.
+// - fuzzCheckDeviceConfig(): aborts if a string of a DeviceConfig lost its terminator.
+// The build (env:fuzz_*, see platformio.ini) leaves src/ out, as this header brings src/main.cpp in.
+
+#pragma once
+
+#include "../../src/main.cpp"
+#include <HttpLoopback.h>
+#include <string>
+
+static const int FUZZ_MAX_PASSES = 100; // server.handleClient() calls allowed for one response
+
+static std::string fuzzBaseline;
+static DeviceConfig fuzzBaselineDevice;
+
+static inline void fuzzBoot()
+{
+  nativeSetSerialOutput(nullptr);
+  nativeBoot(REASON_DEFAULT_RST);
+  setup();
+  fuzzBaseline = currentConfig;
+  fuzzBaselineDevice = deviceConfig;
+}
+
+// fuzzPost(const char* path, const char* prefix, const uint8_t* data, size_t size)
+// POSTs prefix followed by data as a form body to path. Aborts if no complete response arrives.
+
+static inline int fuzzPost(const char* path, const char* prefix, const uint8_t* data, size_t size)
+{
+  HttpLoopbackClient client;
+  if (!client.connect(80)) {
+    fprintf(stderr, "web server refused the connection\n");
+    abort();
+  }
+  size_t prefixLength = strlen(prefix);
+  char head[192];
+  snprintf(head, sizeof(head), "POST %s HTTP/1.1\r\nHost: esp\r\nConnection: close\r\n"
+           "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %u\r\n\r\n",
+           path, (unsigned)(prefixLength + size));
+  client.send(head, strlen(head));
+  client.send(prefix, prefixLength);
+  client.send((const char*)data, size);
+  for (int pass = 0; pass < FUZZ_MAX_PASSES && !client.responseLength(); pass++) {
+    server.handleClient();
+    nativePump();
+  }
+  if (!client.responseLength()) {
+    fprintf(stderr, "no complete response to POST %s (%u bytes received)\n", path,
+            (unsigned)client.received().size());
+    abort();
+  }
+  return atoi(client.received().c_str() + 9);
+}
+
+static inline void fuzzRestore()
+{
+  if (strcmp(currentConfig, fuzzBaseline.c_str()) != 0) {
+    saveConfigToEEPROM(fuzzBaseline.c_str());
+  }
+  deviceConfig = fuzzBaselineDevice;
+}
+
+static inline void fuzzCheckDeviceConfig(const DeviceConfig& cfg)
+{
+  if (strnlen(cfg.ssid, sizeof(cfg.ssid)) == sizeof(cfg.ssid) ||
+      strnlen(cfg.password, sizeof(cfg.password)) == sizeof(cfg.password) ||
+      strnlen(cfg.staticIp, sizeof(cfg.staticIp)) == sizeof(cfg.staticIp) ||
+      strnlen(cfg.gateway, sizeof(cfg.gateway)) == sizeof(cfg.gateway) ||
+      strnlen(cfg.subnet, sizeof(cfg.subnet)) == sizeof(cfg.subnet) ||
+      strnlen(cfg.configMode, sizeof(cfg.configMode)) == sizeof(cfg.configMode)) {
+    fprintf(stderr, "DeviceConfig string without terminator\n");
+    abort();
+  }
+}
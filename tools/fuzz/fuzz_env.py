@@ -0,0 +1,30 @@
+# PlatformIO pre-build script of the fuzz_* environments: picks the compiler for the fuzzing engine and adds the
+# sanitizer flags to compiling and linking (the libraries too, so their code is instrumented as well).
+#
+# FUZZ_ENGINE (environment variable) selects the engine:
+# - libfuzzer (default): clang++ -fsanitize=fuzzer,address,undefined; libFuzzer provides main().
+# - afl: afl-clang-fast++ with the same flags; AFL++ then runs the target in persistent mode under afl-fuzz.
+# - replay: g++ -fsanitize=address,undefined with tools/fuzz/FuzzMain.cpp as main(), for replaying a corpus
+#   or a crash without clang.
+# UBSan findings abort (-fno-sanitize-recover), so they count as crashes like ASan's.
+
+import os
+
+Import("env")
+
+ENGINES = {
+    "libfuzzer": ("clang", "clang++", "-fsanitize=fuzzer,address,undefined"),
+    "afl": ("afl-clang-fast", "afl-clang-fast++", "-fsanitize=fuzzer,address,undefined"),
+    "replay": ("gcc", "g++", "-fsanitize=address,undefined"),
+}
+
+engine = os.environ.get("FUZZ_ENGINE", "libfuzzer")
+if engine not in ENGINES:
+    raise SystemExit("FUZZ_ENGINE must be one of: " + ", ".join(ENGINES))
+cc, cxx, sanitize = ENGINES[engine]
+flags = [sanitize, "-fno-sanitize-recover=undefined", "-fno-omit-frame-pointer", "-O1"]
+
+env.Replace(CC=cc, CXX=cxx, LINK=cxx)
+env.Append(CCFLAGS=flags, LINKFLAGS=flags)
+if engine != "replay":
+    env.Append(CPPDEFINES=["FUZZ_LIBFUZZER"])
@@ -0,0 +1,26 @@
+// Fuzz target: POST /jsonedit through the web server, with the input as the value of the jsondata form field
+// (still URL-encoded, so the in-place form decoding of AsyncHttpServer::formField() is fuzzed too). Covers
+// handleJsonEditor(), compactJson(), applyConfigJson(), parseConfig() and the journal write of an accepted
+// config; checks deviceConfig after it.
+//   pio run -e fuzz_json_editor
+//   .pio/build/fuzz_json_editor/program -dict=tools/fuzz/json.dict .pio/fuzz/json_editor tools/fuzz/corpus/json_editor
+
+#include "FuzzSketch.h"
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+  fuzzBoot();
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+  int status = fuzzPost("/jsonedit", "jsondata=", data, size);
+  if (status != 303 && status != 400 && status != 413) {
+    fprintf(stderr, "POST /jsonedit answered %d\n", status);
+    abort();
+  }
+  fuzzCheckDeviceConfig(deviceConfig);
+  fuzzRestore();
+  return 0;
+}
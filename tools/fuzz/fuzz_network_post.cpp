@@ -0,0 +1,25 @@
+// Fuzz target: POST /network through the web server, with the input as the whole form body (ssid, password,
+// useDhcp, staticIp, gateway, subnet, apFallbackSec, in any order and encoding). Covers the form parsing,
+// handleNetworkConfig(), persistConfig() and applyNetworkConfig(); checks deviceConfig after it.
+//   pio run -e fuzz_network_post
+//   .pio/build/fuzz_network_post/program -dict=tools/fuzz/json.dict .pio/fuzz/network_post tools/fuzz/corpus/network_post
+
+#include "FuzzSketch.h"
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+  fuzzBoot();
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+  int status = fuzzPost("/network", "", data, size);
+  if (status != 303 && status != 400 && status != 413 && status != 500) {
+    fprintf(stderr, "POST /network answered %d\n", status);
+    abort();
+  }
+  fuzzCheckDeviceConfig(deviceConfig);
+  fuzzRestore();
+  return 0;
+}
@@ -0,0 +1,28 @@
+// Fuzz target: parseConfig() on arbitrary text, as stored configs and every JSON editor or /api/config save
+// reach it. Checks that the fixed-size DeviceConfig strings it fills with strlcpy() stay terminated.
+//   pio run -e fuzz_parse_config
+//   .pio/build/fuzz_parse_config/program -dict=tools/fuzz/json.dict .pio/fuzz/parse_config tools/fuzz/corpus/parse_config
+// (new inputs go to the first directory, so the seed corpus in git stays as it is). See platformio.ini.
+
+#include "FuzzSketch.h"
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+  nativeSetSerialOutput(nullptr);
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+  std::string json((const char*)data, size); // parseConfig() takes a terminated string
+  DeviceConfig cfg;
+  memset(&cfg, 0x5A, sizeof(cfg));           // Unterminated garbage, as in an uninitialized stack copy
+  if (parseConfig(json.c_str(), cfg)) {
+    fuzzCheckDeviceConfig(cfg);
+  }
+  if (jsonPool.stats().used != 0) {
+    fprintf(stderr, "parseConfig() left %u bytes allocated in the JSON pool\n", (unsigned)jsonPool.stats().used);
+    abort();
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+# Tracks the throughput of the libFuzzer targets in tools/fuzz: runs each one for a fixed time from its seed
+# corpus and records executions per second and coverage, so a change that makes fuzzing slow (and so finds
+# less) shows up like any other regression.
+#
+# Usage: python tools/fuzz/throughput.py [--seconds 30] [--targets parse_config,json_editor,network_post]
+#                                        [--min-exec 500] [--max-drop 30] [--log .pio/fuzz/throughput.csv]
+#                                        [--no-build]
+# - Builds env:fuzz_<target> with "pio run" first, unless --no-build.
+# - New inputs go to a scratch directory, so the seed corpus in git is not changed.
+# - Appends one line per target to the log (CSV: time, git commit, target, exec/s, runs, coverage) and compares
+#   it with the previous line for that target.
+# - Exits with 1 if a target crashed, ran below --min-exec exec/s, or lost more than --max-drop percent of the
+#   exec/s of its previous run.
+
+import argparse
+import csv
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+TARGETS = ["parse_config", "json_editor", "network_post"]
+DICTIONARY = os.path.join(ROOT, "tools", "fuzz", "json.dict")
+
+
+def git_commit():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "--short", "HEAD"], cwd=ROOT, text=True,
+                                       stderr=subprocess.DEVNULL).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def previous_runs(log):
+    runs = {}
+    if os.path.exists(log):
+        with open(log, newline="") as f:
+            for row in csv.DictReader(f):
+                runs[row["target"]] = row
+    return runs
+
+
+def run_target(target, seconds):
+    program = os.path.join(ROOT, ".pio", "build", "fuzz_" + target, "program")
+    seeds = os.path.join(ROOT, "tools", "fuzz", "corpus", target)
+    with tempfile.TemporaryDirectory() as scratch:
+        args = [program, "-max_total_time=%d" % seconds, "-print_final_stats=1", "-dict=" + DICTIONARY,
+                scratch, seeds]
+        result = subprocess.run(args, cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    output = result.stdout
+    exec_per_sec = re.search(r"stat::average_exec_per_sec:\s*(\d+)", output)
+    runs = re.search(r"stat::number_of_executed_units:\s*(\d+)", output)
+    coverage = re.findall(r"\bcov: (\d+)", output)
+    return {
+        "crashed": result.returncode != 0,
+        "exec_per_sec": int(exec_per_sec.group(1)) if exec_per_sec else 0,
+        "runs": int(runs.group(1)) if runs else 0,
+        "coverage": int(coverage[-1]) if coverage else 0,
+        "output": output,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure and log the exec/s of the fuzz targets.")
+    parser.add_argument("--seconds", type=int, default=30)
+    parser.add_argument("--targets", default=",".join(TARGETS))
+    parser.add_argument("--min-exec", type=int, default=500)
+    parser.add_argument("--max-drop", type=float, default=30)
+    parser.add_argument("--log", default=os.path.join(ROOT, ".pio", "fuzz", "throughput.csv"))
+    parser.add_argument("--no-build", action="store_true")
+    args = parser.parse_args()
+
+    targets = [t for t in args.targets.split(",") if t]
+    previous = previous_runs(args.log)
+    failed = False
+    rows = []
+    for target in targets:
+        if not args.no_build:
+            subprocess.run(["pio", "run", "-e", "fuzz_" + target], cwd=ROOT, check=True)
+        result = run_target(target, args.seconds)
+        line = "%-14s %8d exec/s %10d runs  cov %5d" % (target, result["exec_per_sec"], result["runs"],
+                                                         result["coverage"])
+        last = previous.get(target)
+        if last and int(last["exec_per_sec"]) > 0:
+            change = 100.0 * (result["exec_per_sec"] - int(last["exec_per_sec"])) / int(last["exec_per_sec"])
+            line += "  (%+.0f%% vs %s)" % (change, last["commit"])
+            if change < -args.max_drop:
+                line += "  SLOWER"
+                failed = True
+        if result["crashed"]:
+            line += "  CRASHED"
+            failed = True
+            print(result["output"][-4000:])
+        elif result["exec_per_sec"] < args.min_exec:
+            line += "  BELOW %d exec/s" % args.min_exec
+            failed = True
+        print(line)
+        rows.append({"time": time.strftime("%Y-%m-%d %H:%M:%S"), "commit": git_commit(), "target": target,
+                     "exec_per_sec": result["exec_per_sec"], "runs": result["runs"], "coverage": result["coverage"]})
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.log)), exist_ok=True)
+    new_log = not os.path.exists(args.log)
+    with open(args.log, "a", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["time", "commit", "target", "exec_per_sec", "runs", "coverage"])
+        if new_log:
+            writer.writeheader()
+        writer.writerows(rows)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,66 @@
+# Embeds the files in web/ into include/web_assets.h as PROGMEM arrays.
+#
+# Runs as a PlatformIO pre-build script (extra_scripts in platformio.ini), or by hand
+# with "python tools/gzip_assets.py" when building outside PlatformIO.
+# - Text assets (.css, .js, .html) are gzip-compressed; the firmware serves them with
+#   Content-Encoding: gzip.
+# - Each asset gets a strong ETag: a hash of the bytes as served.
+# - Output is deterministic (gzip mtime 0), so the header only changes when an asset does.
+
+import gzip
+import hashlib
+import os
+import re
+
+COMPRESSED_EXTENSIONS = (".css", ".js", ".html")
+
+
+def asset_symbol(filename):
+    name, ext = os.path.splitext(filename)
+    symbol = re.sub(r"[^0-9a-zA-Z]", "_", name + ext).lower()
+    return symbol + ("_gz" if ext in COMPRESSED_EXTENSIONS else "")
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]))
+    return ",\n".join(lines)
+
+
+def generate(project_dir):
+    web_dir = os.path.join(project_dir, "web")
+    out_path = os.path.join(project_dir, "include", "web_assets.h")
+    out = [
+        "// Generated by tools/gzip_assets.py from web/ - do not edit.",
+        "#pragma once",
+        "#include <Arduino.h>",
+        "",
+    ]
+    for filename in sorted(os.listdir(web_dir)):
+        with open(os.path.join(web_dir, filename), "rb") as f:
+            data = f.read()
+        if filename.endswith(COMPRESSED_EXTENSIONS):
+            data = gzip.compress(data, compresslevel=9, mtime=0)
+        symbol = asset_symbol(filename)
+        etag = hashlib.sha1(data).hexdigest()[:16]
+        out.append("const uint8_t %s[] PROGMEM = {\n%s\n};" % (symbol, c_array(data)))
+        out.append("const size_t %s_len = %d;" % (symbol, len(data)))
+        out.append('#define %s_ETAG "\\"%s\\""' % (re.sub(r"_gz$", "", symbol).upper(), etag))
+        out.append("")
+    text = "\n".join(out)
+
+    if os.path.exists(out_path):
+        with open(out_path) as f:
+            if f.read() == text:
+                return
+    with open(out_path, "w") as f:
+        f.write(text)
+    print("Generated %s" % os.path.relpath(out_path, project_dir))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    generate(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
@@ -0,0 +1,357 @@
+// Load generator for the config portal: replays a weighted mix of GET and POST requests against the sketch
+// itself, built for the host (env:native shims, web server on the in-process loopback), and reports latency
+// percentiles, histograms and failures per route.
+//
+// Build and run (its main() replaces the default one of lib/NativeMain):
+//   pio run -e native_load && .pio/build/native_load/program [options]
+//   --requests N      Requests to complete (default 2000)
+//   --clients N       Concurrent clients (default 3; more than HTTP_MAX_CONNECTIONS are refused or evict others)
+//   --mix SPEC        Weighted routes, "METHOD PATH=WEIGHT,..." (default: DEFAULT_MIX below)
+//   --seed N          Seed of the workload sequence (default 1)
+//   --keep-alive      Reuse connections (default: one connection per request, as with Connection: close)
+//   --window BYTES    Response bytes a connection may send per loop() pass (default 2920, TCP_SND_BUF of the
+//                     ESP8266's lwIP; 0 = unlimited), as the client's ACKs arrive between passes
+//   --timeout MS      Virtual time after which an unanswered request counts as timed out (default 10000)
+//   --flash FILE      Flash image to start from (default: erased, so the device boots into the default config)
+//   --verbose         Keep the sketch's Serial output
+// - POST /network sends a form like the Network Config page, POST /jsonedit a config like the JSON editor;
+//   both vary a field so that some saves reach flash. Other POST routes get an empty body.
+// - Latency is measured twice. Virtual time (millis(), advanced by the delay(10) in loop() and by yield()) is
+//   exactly reproducible: the same options give the same figures on any machine, so regressions in how the
+//   server schedules requests and how many bytes a page takes show up as changed numbers. Host CPU time
+//   measures the cost of the code; it varies between machines and runs, and the ESP8266 at 80 MHz is roughly
+//   50-100x slower.
+// - A request fails if the connection is refused, reset or closed without a response, times out, or gets a
+//   status other than 200 (GET) or 303 (POST). Exits with 1 if any request failed.
+
+#include <Arduino.h>
+#include <AsyncHttpServer.h>
+#include <HttpLoopback.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+extern AsyncHttpServer server;
+
+static const char* DEFAULT_MIX =
+    "GET /network=30,POST /network=5,GET /jsonedit=20,POST /jsonedit=5,GET /favicon.ico=40";
+static const int HISTOGRAM_BUCKETS = 10;     // Virtual ms: <10, <20, <40, ... doubling, the last one open
+static const int HISTOGRAM_WIDTH = 40;
+
+struct Route {
+  std::string method;
+  std::string path;
+  unsigned weight;
+  std::vector<double> virtualMs;             // Latency of each completed request
+  std::vector<double> hostUs;
+  unsigned refused, reset, closed, timeouts, badStatus;
+};
+
+struct LoadClient {
+  HttpLoopbackClient conn;
+  Route* route = nullptr;                    // Request in flight, or nullptr when idle
+  uint64_t startVirtualUs = 0;
+  std::chrono::steady_clock::time_point startHost;
+};
+
+static uint32_t randomState;
+
+static uint32_t nextRandom()
+{
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 8;
+}
+
+// parseMix(const char* spec, std::vector<Route>& routes)
+// Fills routes from "METHOD PATH=WEIGHT,..."; returns false on a malformed entry.
+
+static bool parseMix(const char* spec, std::vector<Route>& routes)
+{
+  std::string text(spec);
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find(',', start);
+    if (end == std::string::npos) end = text.size();
+    std::string entry = text.substr(start, end - start);
+    size_t space = entry.find(' ');
+    size_t equals = entry.rfind('=');
+    if (space == std::string::npos || equals == std::string::npos || equals < space) return false;
+    Route route = {};
+    route.method = entry.substr(0, space);
+    route.path = entry.substr(space + 1, equals - space - 1);
+    route.weight = strtoul(entry.c_str() + equals + 1, nullptr, 10);
+    if (route.path.empty() || route.path[0] != '/' || route.weight == 0) return false;
+    routes.push_back(route);
+    start = end + 1;
+  }
+  return !routes.empty();
+}
+
+// urlEncode(const std::string& text)
+// Encodes text as a form field value (application/x-www-form-urlencoded).
+
+static std::string urlEncode(const std::string& text)
+{
+  std::string encoded;
+  for (unsigned char c : text) {
+    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      encoded += (char)c;
+    } else {
+      char hex[4];
+      snprintf(hex, sizeof(hex), "%%%02X", c);
+      encoded += hex;
+    }
+  }
+  return encoded;
+}
+
+// requestBody(const Route& route)
+// Returns the form body for a POST to route. Values cycle through a few variants, so the device sees both
+// real changes and resubmissions of the stored config (which it skips without a flash write).
+
+static std::string requestBody(const Route& route)
+{
+  unsigned variant = nextRandom() % 4;
+  char text[256];
+  if (route.path == "/network") {
+    snprintf(text, sizeof(text), "ssid=LoadNet%u&password=secret%u&useDhcp=1&staticIp=&gateway=&subnet="
+             "&apFallbackSec=0", variant, variant);
+    return text;
+  }
+  if (route.path == "/jsonedit") {
+    snprintf(text, sizeof(text), "{\"network\":{\"ssid\":\"EditNet%u\",\"password\":\"secret\",\"useDhcp\":true,"
+             "\"staticIp\":\"\",\"gateway\":\"\",\"subnet\":\"\",\"apFallbackSec\":0},\"configMode\":\"CONFIG\","
+             "\"app\":{\"label\":\"load test %u\",\"interval\":%u}}", variant, variant, 1000 * (variant + 1));
+    return "jsondata=" + urlEncode(text);
+  }
+  return "";
+}
+
+// startRequest(LoadClient& client, Route& route, bool keepAlive, size_t window)
+// Connects the client if needed and sends one request for route; returns false if the server refused it.
+
+static bool startRequest(LoadClient& client, Route& route, bool keepAlive, size_t window)
+{
+  if (!client.conn.connected() && !client.conn.connect(80)) {
+    return false;
+  }
+  if (window) client.conn.setSendWindow(window);
+  std::string request = route.method + " " + route.path + " HTTP/1.1\r\nHost: esp\r\nConnection: " +
+                        (keepAlive ? "keep-alive" : "close") + "\r\n";
+  if (route.method == "POST") {
+    std::string body = requestBody(route);
+    request += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\n\r\n" + body;
+  } else {
+    request += "\r\n";
+  }
+  client.route = &route;
+  client.startVirtualUs = nativeMicros64();
+  client.startHost = std::chrono::steady_clock::now();
+  client.conn.send(request);
+  return true;
+}
+
+// checkResponse(LoadClient& client, unsigned long timeoutMs, size_t window)
+// Completes the client's request if its response has arrived or it failed; returns true if it is done.
+// Otherwise opens the send window by another window bytes for the next pass.
+
+static bool checkResponse(LoadClient& client, unsigned long timeoutMs, size_t window)
+{
+  Route& route = *client.route;
+  size_t length = client.conn.responseLength();
+  if (length) {
+    double virtualMs = (nativeMicros64() - client.startVirtualUs) / 1000.0;
+    double hostUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                              client.startHost).count();
+    int status = atoi(client.conn.received().c_str() + 9);
+    client.conn.consume(length);
+    if (status == (route.method == "POST" ? 303 : 200)) {
+      route.virtualMs.push_back(virtualMs);
+      route.hostUs.push_back(hostUs);
+    } else {
+      route.badStatus++;
+    }
+  } else if (client.conn.reset()) {
+    route.reset++;
+  } else if (!client.conn.connected()) {
+    route.closed++;
+  } else if (nativeMicros64() - client.startVirtualUs > timeoutMs * 1000ULL) {
+    client.conn.abort();
+    route.timeouts++;
+  } else {
+    if (window) client.conn.setSendWindow(client.conn.received().size() + window);
+    return false;
+  }
+  client.route = nullptr;
+  return true;
+}
+
+// percentile(const std::vector<double>& sorted, double fraction)
+// Nearest-rank percentile of sorted values (0 if there are none).
+
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+  if (sorted.empty()) return 0;
+  size_t rank = (size_t)(fraction * sorted.size() + 0.999999);
+  return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+// printHistogram(const Route& route)
+// Prints the virtual latency of route in doubling buckets from 10 ms (one loop() pass), up to the last
+// bucket in use.
+
+static void printHistogram(const Route& route)
+{
+  unsigned counts[HISTOGRAM_BUCKETS] = {};
+  int used = 1;
+  for (double ms : route.virtualMs) {
+    int bucket = 0;
+    for (double limit = 10; ms >= limit && bucket < HISTOGRAM_BUCKETS - 1; limit *= 2) bucket++;
+    counts[bucket]++;
+    used = std::max(used, bucket + 1);
+  }
+  unsigned most = *std::max_element(counts, counts + HISTOGRAM_BUCKETS);
+  printf("\n%s %s (virtual ms)\n", route.method.c_str(), route.path.c_str());
+  double low = 0;
+  for (int bucket = 0; bucket < used; bucket++) {
+    double high = 10 << bucket;
+    int bar = most ? (int)((uint64_t)counts[bucket] * HISTOGRAM_WIDTH / most) : 0;
+    if (bucket < HISTOGRAM_BUCKETS - 1) {
+      printf("  %6.0f - %-6.0f %7u %s\n", low, high, counts[bucket], std::string(bar, '#').c_str());
+    } else {
+      printf("  %6.0f +       %7u %s\n", low, counts[bucket], std::string(bar, '#').c_str());
+    }
+    low = high;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long requests = 2000;
+  unsigned clientCount = 3;
+  const char* mix = DEFAULT_MIX;
+  uint32_t seed = 1;
+  bool keepAlive = false;
+  unsigned long timeoutMs = 10000;
+  size_t window = 2920;
+  const char* flashPath = nullptr;
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "--keep-alive")) {
+      keepAlive = true;
+    } else if (!strcmp(arg, "--verbose")) {
+      verbose = true;
+    } else if (hasValue && !strcmp(arg, "--requests")) {
+      requests = strtoul(argv[++i], nullptr, 10);
+    } else if (hasValue && !strcmp(arg, "--clients")) {
+      clientCount = strtoul(argv[++i], nullptr, 10);
+    } else if (hasValue && !strcmp(arg, "--mix")) {
+      mix = argv[++i];
+    } else if (hasValue && !strcmp(arg, "--seed")) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if (hasValue && !strcmp(arg, "--window")) {
+      window = strtoul(argv[++i], nullptr, 10);
+    } else if (hasValue && !strcmp(arg, "--timeout")) {
+      timeoutMs = strtoul(argv[++i], nullptr, 10);
+    } else if (hasValue && !strcmp(arg, "--flash")) {
+      flashPath = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--requests N] [--clients N] [--mix SPEC] [--seed N] [--keep-alive] "
+                      "[--window BYTES] [--timeout MS] [--flash FILE] [--verbose]\n", argv[0]);
+      return 2;
+    }
+  }
+  std::vector<Route> routes;
+  if (!parseMix(mix, routes) || clientCount == 0 || requests == 0) {
+    fprintf(stderr, "invalid workload: --mix \"%s\", %u clients, %lu requests\n", mix, clientCount, requests);
+    return 2;
+  }
+  unsigned totalWeight = 0;
+  for (const Route& route : routes) totalWeight += route.weight;
+
+  if (flashPath) nativeLoadImage(flashPath, nativeFlash(), NATIVE_FLASH_SIZE);
+  if (!verbose) nativeSetSerialOutput(nullptr);
+  nativeBoot(REASON_DEFAULT_RST);
+  setup();
+  nativeFlashStats() = NativeFlashStats();
+  randomState = seed;
+
+  std::vector<std::unique_ptr<LoadClient>> clients;
+  for (unsigned i = 0; i < clientCount; i++) clients.emplace_back(new LoadClient());
+  unsigned long issued = 0;
+  unsigned long finished = 0;
+  uint64_t startVirtualUs = nativeMicros64();
+  auto startHost = std::chrono::steady_clock::now();
+  try {
+    while (finished < requests) {
+      for (std::unique_ptr<LoadClient>& client : clients) {
+        if (client->route || issued == requests) continue;
+        unsigned pick = nextRandom() % totalWeight;
+        Route* route = &routes[0];
+        for (Route& candidate : routes) {
+          if (pick < candidate.weight) {
+            route = &candidate;
+            break;
+          }
+          pick -= candidate.weight;
+        }
+        issued++;
+        if (!startRequest(*client, *route, keepAlive, window)) {
+          route->refused++;
+          finished++;
+        }
+      }
+      loop();
+      nativePump();
+      for (std::unique_ptr<LoadClient>& client : clients) {
+        if (client->route && checkResponse(*client, timeoutMs, window)) finished++;
+      }
+    }
+  } catch (const NativeRestart&) {
+    printf("ESP.restart() after %lu requests; the workload must not restart the device\n", finished);
+    return 1;
+  }
+  double virtualSec = (nativeMicros64() - startVirtualUs) / 1e6;
+  double hostSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - startHost).count();
+
+  printf("Workload: %lu requests, %u clients, seed %u, %s, send window %u\n", requests, clientCount,
+         (unsigned)seed, keepAlive ? "keep-alive" : "one connection per request", (unsigned)window);
+  printf("%-22s %6s %6s %8s %8s %8s %8s %10s %10s\n", "Route", "OK", "Failed", "p50 ms", "p90 ms", "p99 ms",
+         "max ms", "host p50us", "host p99us");
+  unsigned long failures = 0;
+  for (Route& route : routes) {
+    std::sort(route.virtualMs.begin(), route.virtualMs.end());
+    std::sort(route.hostUs.begin(), route.hostUs.end());
+    unsigned failed = route.refused + route.reset + route.closed + route.timeouts + route.badStatus;
+    failures += failed;
+    std::string name = route.method + " " + route.path;
+    printf("%-22s %6u %6u %8.1f %8.1f %8.1f %8.1f %10.1f %10.1f\n", name.c_str(), (unsigned)route.virtualMs.size(),
+           failed, percentile(route.virtualMs, 0.5), percentile(route.virtualMs, 0.9),
+           percentile(route.virtualMs, 0.99), percentile(route.virtualMs, 1.0), percentile(route.hostUs, 0.5),
+           percentile(route.hostUs, 0.99));
+    if (failed) {
+      printf("  failures: %u refused, %u reset, %u closed without response, %u timed out, %u wrong status\n",
+             route.refused, route.reset, route.closed, route.timeouts, route.badStatus);
+    }
+  }
+  printf("Throughput: %.1f requests/s virtual (%.2f s), %.0f requests/s host CPU (%.3f s)\n",
+         requests / virtualSec, virtualSec, requests / hostSec, hostSec);
+  const HttpServerStats& web = server.stats();
+  printf("Server: %u connections accepted, %u refused, peak %u at once, %u reused, %u timeouts\n",
+         (unsigned)web.connectionsAccepted, (unsigned)web.connectionsRejected, (unsigned)web.peakConnections,
+         (unsigned)web.connectionReuses, (unsigned)web.timeouts);
+  printf("Buffers: peak %u of %u bytes (bodies and queued output), %u responses cut\n",
+         (unsigned)web.peakBufferedBytes, (unsigned)HTTP_BUFFER_BUDGET, (unsigned)web.responsesCut);
+  const NativeFlashStats& flash = nativeFlashStats();
+  printf("Flash: %u writes (%u bytes), %u sector erases\n", (unsigned)flash.writes, (unsigned)flash.bytesWritten,
+         (unsigned)flash.erases);
+  for (const Route& route : routes) printHistogram(route);
+  return failures ? 1 : 0;
+}
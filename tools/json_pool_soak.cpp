@@ -0,0 +1,143 @@
+// Host-side soak test of lib/JsonPool: runs thousands of simulated portal requests through ArduinoJson with
+// every document on a JsonPoolAllocator the size of the firmware's, and checks that the pool is back to one
+// free block of full size after each request, i.e. that request-scoped JSON work leaves no fragmentation.
+//
+// Build and run (env:json_pool_soak: the pinned ArduinoJson from lib_deps, built 32-bit):
+//   pio run -e json_pool_soak && .pio/build/json_pool_soak/program [requests] [pool bytes]
+//   requests      Simulated requests (default 20000)
+//   pool bytes    Pool size (default 6144, JSON_POOL_SIZE)
+// - -m32 gives ArduinoJson the ESP8266's 32-bit slot sizes; a 64-bit build works too but needs about twice the
+//   pool, so expect heap fallbacks there.
+// - Requests mix the firmware's JSON paths: parseConfig() (read a few fields), persistConfig() (parse, modify,
+//   serialize), a JSON editor save (parse a new document, serialize) and an /api/config PATCH (two documents
+//   alive at once, merged). Configs range from ~250 bytes to ~2 KB of project-specific keys.
+// - Prints pool usage, largest free block and fragmentation every 1000 requests. Exits with 1 if the pool
+//   ever failed to return to a single free block between requests, or a request failed.
+
+#include <ArduinoJson.h>
+#include "JsonPoolAllocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static uint32_t randomState = 12345;
+
+static uint32_t nextRandom()
+{
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 8;
+}
+
+// makeConfig(size_t sensors)
+// Returns a config like the firmware's, extended with a project-specific "app" object of sensors entries.
+
+static std::string makeConfig(size_t sensors)
+{
+  JsonDocument doc; // Test input only, on the default allocator
+  JsonObject network = doc["network"].to<JsonObject>();
+  network["ssid"] = "HomeNetwork";
+  network["password"] = "correct horse battery";
+  network["useDhcp"] = nextRandom() % 2 == 0;
+  network["staticIp"] = "192.168.1.50";
+  network["gateway"] = "192.168.1.1";
+  network["subnet"] = "255.255.255.0";
+  network["apFallbackSec"] = 300;
+  doc["configMode"] = nextRandom() % 2 ? "RUN" : "CONFIG";
+  JsonObject app = doc["app"].to<JsonObject>();
+  for (size_t i = 0; i < sensors; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "sensor%u", (unsigned)i);
+    JsonObject sensor = app[key].to<JsonObject>();
+    sensor["pin"] = i % 17;
+    sensor["label"] = std::string(nextRandom() % 24, 'a' + i % 26);
+    sensor["scale"] = 0.5 + i;
+  }
+  std::string json;
+  serializeJson(doc, json);
+  return json;
+}
+
+static bool parseConfigRequest(JsonPoolAllocator& pool, const std::string& config)
+{
+  JsonDocument doc(&pool);
+  if (deserializeJson(doc, config)) return false;
+  bool useDhcp = doc["network"]["useDhcp"] | true;
+  const char* mode = doc["configMode"] | "RUN";
+  return mode[0] != '\0' || useDhcp;
+}
+
+static bool persistConfigRequest(JsonPoolAllocator& pool, const std::string& config)
+{
+  JsonDocument doc(&pool);
+  if (deserializeJson(doc, config)) return false;
+  doc["network"]["ssid"] = "OtherNetwork";
+  doc["configMode"] = "CONFIG";
+  char newJson[2048];
+  return serializeJson(doc, newJson, sizeof(newJson)) > 0;
+}
+
+static bool editorSaveRequest(JsonPoolAllocator& pool, const std::string& newConfig)
+{
+  JsonDocument doc(&pool);
+  if (deserializeJson(doc, newConfig) || measureJson(doc) >= 2048) return false;
+  char newJson[2048];
+  return serializeJson(doc, newJson, sizeof(newJson)) > 0;
+}
+
+static bool patchRequest(JsonPoolAllocator& pool, const std::string& config, const std::string& patch)
+{
+  JsonDocument body(&pool);
+  JsonDocument merged(&pool);
+  if (deserializeJson(body, patch) || deserializeJson(merged, config)) return false;
+  for (JsonPair member : body.as<JsonObject>()) {
+    merged[member.key()] = member.value();
+  }
+  char newJson[4096];
+  return serializeJson(merged, newJson, sizeof(newJson)) > 0;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long requests = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+  size_t poolSize = argc > 2 ? strtoul(argv[2], nullptr, 10) : 6144;
+  void* memory = malloc(poolSize);
+  JsonPoolAllocator pool(memory, poolSize);
+  size_t idleLargest = pool.largestFreeBlock();
+  unsigned long unstable = 0;
+  unsigned long failed = 0;
+  size_t lowestLargest = idleLargest;
+
+  std::string config = makeConfig(4);
+  printf("pool %u bytes, %lu requests\n", (unsigned)pool.size(), requests);
+  for (unsigned long i = 1; i <= requests; i++) {
+    bool ok = true;
+    switch (nextRandom() % 4) {
+      case 0: ok = parseConfigRequest(pool, config); break;
+      case 1: ok = persistConfigRequest(pool, config); break;
+      case 2: {
+        std::string newConfig = makeConfig(nextRandom() % 24);
+        ok = editorSaveRequest(pool, newConfig);
+        if (ok) config = newConfig;
+        break;
+      }
+      default: ok = patchRequest(pool, config, makeConfig(nextRandom() % 6)); break;
+    }
+    if (!ok) failed++;
+
+    size_t largest = pool.largestFreeBlock();
+    if (largest < lowestLargest) lowestLargest = largest;
+    if (pool.stats().used != 0 || largest != idleLargest) unstable++;
+    if (i % 1000 == 0) {
+      const JsonPoolStats& stats = pool.stats();
+      printf("%6lu requests: config %4u bytes, peak %4u bytes, largest free %4u, fragmentation %u%%, "
+             "%u allocations, %u heap fallbacks\n",
+             i, (unsigned)config.size(), (unsigned)stats.peakUsed, (unsigned)largest, (unsigned)pool.fragmentation(),
+             (unsigned)stats.allocations, (unsigned)stats.heapFallbacks);
+    }
+  }
+
+  printf("largest free block between requests: idle %u, lowest %u\n", (unsigned)idleLargest, (unsigned)lowestLargest);
+  printf("%lu requests left the pool fragmented, %lu failed to parse/serialize\n", unstable, failed);
+  free(memory);
+  return unstable == 0 && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+// Host-side benchmark of the firmware's config readers on a large (~2 KB) config: full deserialization,
+// the filtered deserialization of parseConfig() (network + configMode only) and findJsonMember() (configMode
+// only, as persistConfigMode() uses it). Reports time per read and the peak JSON pool memory of each.
+//
+// Build and run (env:json_read_bench: the pinned ArduinoJson from lib_deps, built 32-bit):
+//   pio run -e json_read_bench && .pio/build/json_read_bench/program [iterations (20000)]
+// - Host times only compare the readers with each other; the ESP8266 at 80 MHz is roughly 50-100x slower.
+// - Memory is exact for the slot size of the build; the env's -m32 matches the ESP8266.
+
+#include <ArduinoJson.h>
+#include "JsonFieldScanner.h"
+#include "JsonPoolAllocator.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static const size_t POOL_SIZE = 16384; // Large enough that no reader falls back to the heap
+
+// makeConfig()
+// Returns the default network settings plus ~1.8 KB of project-specific keys.
+
+static std::string makeConfig()
+{
+  JsonDocument doc;
+  JsonObject network = doc["network"].to<JsonObject>();
+  network["ssid"] = "HomeNetwork";
+  network["password"] = "correct horse battery";
+  network["useDhcp"] = false;
+  network["staticIp"] = "192.168.1.50";
+  network["gateway"] = "192.168.1.1";
+  network["subnet"] = "255.255.255.0";
+  network["apFallbackSec"] = 300;
+  JsonObject app = doc["app"].to<JsonObject>();
+  for (int i = 0; i < 24; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "sensor%d", i);
+    JsonObject sensor = app[key].to<JsonObject>();
+    sensor["pin"] = i % 17;
+    sensor["label"] = "Greenhouse probe";
+    sensor["scale"] = 0.5 + i;
+    sensor["enabled"] = i % 3 != 0;
+  }
+  doc["configMode"] = "RUN"; // Last, as after a PATCH: the scanner has to walk the whole document
+  std::string json;
+  serializeJson(doc, json);
+  return json;
+}
+
+// Each reader returns the configMode it found, so the compiler cannot drop the work.
+
+static char readFull(JsonPoolAllocator& pool, const char* json)
+{
+  JsonDocument doc(&pool);
+  if (deserializeJson(doc, json)) return '?';
+  const char* mode = doc["configMode"] | "RUN";
+  bool useDhcp = doc["network"]["useDhcp"] | true;
+  return useDhcp ? mode[0] : mode[1];
+}
+
+static char readFiltered(JsonPoolAllocator& pool, const char* json)
+{
+  JsonDocument filter(&pool);
+  filter["network"] = true;
+  filter["configMode"] = true;
+  JsonDocument doc(&pool);
+  if (deserializeJson(doc, json, DeserializationOption::Filter(filter))) return '?';
+  const char* mode = doc["configMode"] | "RUN";
+  bool useDhcp = doc["network"]["useDhcp"] | true;
+  return useDhcp ? mode[0] : mode[1];
+}
+
+static char readScanned(JsonPoolAllocator&, const char* json)
+{
+  size_t length;
+  const char* mode = findJsonMember(json, "configMode", &length);
+  return mode && length > 2 ? mode[2] : '?';
+}
+
+static void bench(const char* name, char (*reader)(JsonPoolAllocator&, const char*), const char* json,
+                  unsigned long iterations)
+{
+  void* memory = malloc(POOL_SIZE);
+  JsonPoolAllocator pool(memory, POOL_SIZE);
+  unsigned checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++) {
+    checksum += reader(pool, json);
+  }
+  double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  printf("%-10s %8.2f us/read  peak %5u bytes  %3u allocations/read  (%u)\n", name, elapsed / iterations,
+         (unsigned)pool.stats().peakUsed, (unsigned)(pool.stats().allocations / iterations), checksum & 0xff);
+  free(memory);
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+  std::string json = makeConfig();
+  printf("config %u bytes, %lu reads each\n", (unsigned)json.size(), iterations);
+  bench("full", readFull, json.c_str(), iterations);
+  bench("filtered", readFiltered, json.c_str(), iterations);
+  bench("scanner", readScanned, json.c_str(), iterations);
+  return 0;
+}
@@ -0,0 +1,7 @@
+# PlatformIO pre-build script of the json_* environments: builds and links 32-bit (-m32), so ArduinoJson uses
+# the ESP8266's slot sizes and the pool figures match the firmware's. Needs a multilib toolchain
+# (gcc-multilib and g++-multilib on Debian/Ubuntu).
+
+Import("env")
+
+env.Append(CCFLAGS=["-m32"], LINKFLAGS=["-m32"])
@@ -0,0 +1,293 @@
+// =====================================================================
+// power_loss
+// =====================================================================
+// Power-loss injection for the config storage. For each scenario, runs one config operation once per flash
+// step it takes, with the power cut in that step (nativeCutPowerAt(): every programmed byte and every sector
+// erase is a step). After each cut it boots the device again through loadConfigFromEEPROM() and classifies
+// the config it comes back with:
+// - old:     the config from before the operation
+// - new:     the config the operation writes (for a factory reset, the defaults)
+// - stale:   a config saved before old; the journal fell back too far
+// - default: the defaults, although the operation did not write them; the config was lost
+// - corrupt: anything else
+// It then saves one more config and boots again; if that config does not come back, the cut left the storage
+// unusable ("next save lost"). The corruption rate of a scenario is the share of cut points that end in
+// neither old nor new, or lose the next save.
+//
+// Scenarios:
+// - patch:         a small change (the SSID), stored as a patch record
+// - rewrite:       the config replaced by a larger, different one
+// - compaction:    a save into a full sector: erases the next sector and writes a snapshot there
+// - factory-reset: performFactoryReset(): formats the journal and wipes the legacy EEPROM sector
+//
+// Build and run (this main() replaces the default one of lib/NativeMain):
+//   pio run -e native_power_loss && .pio/build/native_power_loss/program [options]
+//   --scenario NAME       Run only this scenario (repeatable; default: all)
+//   --max-corruption PCT  Corruption rate allowed per scenario (default 0)
+//   --verbose             Print the outcome of every cut point, not only the bad ones
+// Exits with 1 if a scenario is above --max-corruption or did not run as expected.
+
+#include "Arduino.h"
+#include <string>
+#include <vector>
+
+void loadConfigFromEEPROM();
+bool saveConfigToEEPROM(const char* newConfig);
+void performFactoryReset();
+extern char currentConfig[];
+extern const char* defaultConfigJson;
+extern bool configQuiet;
+
+enum Outcome { OUTCOME_OLD, OUTCOME_NEW, OUTCOME_STALE, OUTCOME_DEFAULT, OUTCOME_CORRUPT, OUTCOME_COUNT };
+
+static const char* outcomeNames[OUTCOME_COUNT] = { "old", "new", "stale", "default", "corrupt" };
+
+static const int MAX_FILL_SAVES = 64;   // Saves allowed to fill a sector for the compaction scenario
+
+static bool verbose = false;
+
+// Scenario
+// - prepare: brings the storage into the state before the operation, starting from the defaults. Each config
+//   it saves is appended to history, oldest first.
+// - operation: the interrupted work; saves one config or runs a factory reset.
+
+struct Scenario {
+  const char* name;
+  void (*prepare)(std::vector<std::string>& history);
+  void (*operation)();
+};
+
+// makeConfig(const char* ssid, size_t padding)
+// Returns a config document for the network ssid; padding adds an "app" member of that many characters, to
+// vary the record size.
+
+static std::string makeConfig(const char* ssid, size_t padding)
+{
+  std::string config = std::string("{\"network\":{\"ssid\":\"") + ssid +
+                       "\",\"password\":\"correct horse\",\"useDhcp\":true,\"staticIp\":\"\",\"gateway\":\"\","
+                       "\"subnet\":\"\",\"apFallbackSec\":0},\"configMode\":\"RUN\"";
+  if (padding) {
+    config += ",\"app\":\"";
+    for (size_t i = 0; i < padding; i++) {
+      config += (char)('a' + i % 26);
+    }
+    config += "\"";
+  }
+  return config + "}";
+}
+
+static void save(std::vector<std::string>& history, const std::string& config)
+{
+  saveConfigToEEPROM(config.c_str());
+  history.push_back(config);
+}
+
+// boot()
+// Power-on as far as the config: what setup() does before it reads currentConfig.
+
+static void boot()
+{
+  nativeBoot(REASON_DEFAULT_RST);
+  loadConfigFromEEPROM();
+}
+
+static void preparePatch(std::vector<std::string>& history)
+{
+  save(history, makeConfig("HomeNetwork", 0));
+}
+
+static void operationPatch()
+{
+  saveConfigToEEPROM(makeConfig("HomeNetwork-5G", 0).c_str());
+}
+
+static void prepareRewrite(std::vector<std::string>& history)
+{
+  save(history, makeConfig("HomeNetwork", 0));
+}
+
+static void operationRewrite()
+{
+  saveConfigToEEPROM(makeConfig("Workshop", 1200).c_str());
+}
+
+// runOperation(void (*operation)())
+// Runs operation to its end, which for a factory reset is ESP.restart().
+
+static void runOperation(void (*operation)())
+{
+  try {
+    operation();
+  } catch (const NativeRestart&) {
+  }
+}
+
+// prepareCompaction(std::vector<std::string>& history)
+// Saves alternating large configs until the operation would have to erase a sector to fit.
+
+static void operationCompaction()
+{
+  saveConfigToEEPROM(makeConfig("Cabin", 900).c_str());
+}
+
+static void prepareCompaction(std::vector<std::string>& history)
+{
+  std::vector<uint8_t> image(NATIVE_FLASH_SIZE);
+  for (int fill = 0; fill < MAX_FILL_SAVES; fill++) {
+    memcpy(image.data(), nativeFlash(), NATIVE_FLASH_SIZE);
+    uint32_t erases = nativeFlashStats().erases;
+    runOperation(operationCompaction);
+    bool compacts = nativeFlashStats().erases != erases;
+    memcpy(nativeFlash(), image.data(), NATIVE_FLASH_SIZE);
+    boot();
+    if (compacts) return;
+    save(history, makeConfig(fill % 2 ? "Garage" : "Office", 700 + fill % 3 * 100));
+  }
+  printf("compaction: no sector filled up after %d saves\n", MAX_FILL_SAVES);
+}
+
+static void prepareFactoryReset(std::vector<std::string>& history)
+{
+  save(history, makeConfig("HomeNetwork", 0));
+  save(history, makeConfig("HomeNetwork", 300));
+}
+
+static const Scenario scenarios[] = {
+  { "patch", preparePatch, operationPatch },
+  { "rewrite", prepareRewrite, operationRewrite },
+  { "compaction", prepareCompaction, operationCompaction },
+  { "factory-reset", prepareFactoryReset, performFactoryReset },
+};
+
+static Outcome classify(const std::string& config, const std::string& oldConfig, const std::string& newConfig,
+                        const std::vector<std::string>& history)
+{
+  if (config == oldConfig) return OUTCOME_OLD;
+  if (config == newConfig) return OUTCOME_NEW;
+  if (config == defaultConfigJson) return OUTCOME_DEFAULT;
+  for (const std::string& earlier : history) {
+    if (config == earlier) return OUTCOME_STALE;
+  }
+  return OUTCOME_CORRUPT;
+}
+
+// runScenario(const Scenario& scenario, double maxCorruption)
+// Prepares the storage, counts the flash steps of a complete run, then cuts the power at each of them in
+// turn. Prints one report line; returns false if the corruption rate is above maxCorruption.
+
+static bool runScenario(const Scenario& scenario, double maxCorruption)
+{
+  memset(nativeFlash(), 0xFF, NATIVE_FLASH_SIZE);
+  boot();
+  std::vector<std::string> history = { defaultConfigJson };
+  scenario.prepare(history);
+  std::string oldConfig = currentConfig;
+  std::vector<uint8_t> image(nativeFlash(), nativeFlash() + NATIVE_FLASH_SIZE);
+
+  boot();
+  uint64_t firstStep = nativeFlashSteps();
+  uint32_t erases = nativeFlashStats().erases;
+  runOperation(scenario.operation);
+  uint64_t steps = nativeFlashSteps() - firstStep;
+  erases = nativeFlashStats().erases - erases;
+  boot();
+  std::string newConfig = currentConfig;
+  if (newConfig == oldConfig) {
+    printf("%-14s the operation did not change the config\n", scenario.name);
+    return false;
+  }
+
+  unsigned counts[OUTCOME_COUNT] = {};
+  unsigned nextSaveLost = 0;
+  unsigned badCuts = 0;
+  bool completed = false;
+  for (uint64_t cut = 0; cut < steps; cut++) {
+    memcpy(nativeFlash(), image.data(), NATIVE_FLASH_SIZE);
+    boot();
+    nativeCutPowerAt(cut);
+    bool interrupted = false;
+    try {
+      scenario.operation();
+    } catch (const NativePowerLoss&) {
+      interrupted = true;
+    } catch (const NativeRestart&) {
+    }
+    nativeCutPowerAt(-1);
+    completed |= !interrupted;
+
+    boot();
+    Outcome outcome = classify(currentConfig, oldConfig, newConfig, history);
+    counts[outcome]++;
+    std::string next = makeConfig("AfterPowerLoss", cut % 97);
+    saveConfigToEEPROM(next.c_str());
+    boot();
+    bool lost = next != currentConfig;
+    nextSaveLost += lost;
+    bool bad = lost || (outcome != OUTCOME_OLD && outcome != OUTCOME_NEW);
+    badCuts += bad;
+    if (verbose || bad) {
+      printf("%-14s cut at step %u of %u: %s%s\n", scenario.name, (unsigned)cut, (unsigned)steps,
+             outcomeNames[outcome], lost ? ", next save lost" : "");
+    }
+  }
+
+  double rate = steps ? 100.0 * badCuts / steps : 0;
+  printf("%-14s %6u %6u", scenario.name, (unsigned)steps, (unsigned)erases);
+  for (unsigned count : counts) {
+    printf(" %7u", count);
+  }
+  printf(" %9u %9.2f%%\n", nextSaveLost, rate);
+  if (completed) {
+    printf("%-14s a cut did not interrupt the operation; it takes fewer steps than the first run\n", scenario.name);
+    return false;
+  }
+  return rate <= maxCorruption;
+}
+
+int main(int argc, char** argv)
+{
+  double maxCorruption = 0;
+  std::vector<const char*> selected;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--verbose")) {
+      verbose = true;
+    } else if (value && !strcmp(arg, "--scenario")) {
+      selected.push_back(argv[++i]);
+    } else if (value && !strcmp(arg, "--max-corruption")) {
+      maxCorruption = strtod(argv[++i], nullptr);
+    } else {
+      fprintf(stderr, "usage: %s [--scenario NAME]... [--max-corruption PCT] [--verbose]\n", argv[0]);
+      return 2;
+    }
+  }
+  for (const char* name : selected) {
+    bool known = false;
+    for (const Scenario& scenario : scenarios) {
+      known |= !strcmp(scenario.name, name);
+    }
+    if (!known) {
+      fprintf(stderr, "unknown scenario: %s\n", name);
+      return 2;
+    }
+  }
+
+  nativeSetSerialOutput(nullptr);
+  configQuiet = true;
+  printf("%-14s %6s %6s", "scenario", "steps", "erases");
+  for (const char* name : outcomeNames) {
+    printf(" %7s", name);
+  }
+  printf(" %9s %10s\n", "next-lost", "corruption");
+
+  bool passed = true;
+  for (const Scenario& scenario : scenarios) {
+    bool run = selected.empty();
+    for (const char* name : selected) {
+      run |= !strcmp(scenario.name, name);
+    }
+    if (run && !runScenario(scenario, maxCorruption)) passed = false;
+  }
+  return passed ? 0 : 1;
+}